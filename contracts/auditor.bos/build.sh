@@ -1,4 +1,4 @@
 #!/usr/bin/env bash
 
 cd src
-eosio-cpp auditorbos.cpp -o ../auditorbos.wasm -abigen -I ../include -I ./ -R ../resources
+eosio-cpp auditorbos.cpp -o ../auditorbos.wasm -abigen -I ../include -I ../../common/include -I ./ -R ../resources
@@ -3,7 +3,11 @@
 #include <eosiolib/singleton.hpp>
 #include <eosiolib/time.hpp>
 
+#include <algorithm>
+#include <optional>
+
 #include "external_types.hpp"
+#include "upsert.hpp"
 
 #define _STRINGIZE(x) #x
 #define STRINGIZE(x) _STRINGIZE(x)
@@ -87,6 +91,14 @@ struct [[eosio::table("state"), eosio::contract("auditorbos")]] contr_state {
     uint32_t number_active_candidates = 0;
     bool met_initial_votes_threshold = false;
 
+    bool operator==(const contr_state &other) const {
+        return lastperiodtime == other.lastperiodtime &&
+               total_weight_of_votes == other.total_weight_of_votes &&
+               total_votes_on_candidates == other.total_votes_on_candidates &&
+               number_active_candidates == other.number_active_candidates &&
+               met_initial_votes_threshold == other.met_initial_votes_threshold;
+    }
+
     EOSLIB_SERIALIZE(contr_state, (lastperiodtime)
             (total_weight_of_votes)
             (total_votes_on_candidates)
@@ -97,9 +109,9 @@ struct [[eosio::table("state"), eosio::contract("auditorbos")]] contr_state {
 
 typedef singleton<"state"_n, contr_state> statecontainer;
 
-// Utility to combine ids to help with indexing.
+// Utility to combine ids to help with indexing, `boolvalue` takes the upper 64 bits so both parts never overlap.
 uint128_t combine_ids(const uint8_t &boolvalue, const uint64_t &longValue) {
-    return (uint128_t{boolvalue} << 8) | longValue;
+    return (uint128_t{boolvalue} << 64) | longValue;
 }
 
 /**
@@ -121,12 +133,16 @@ struct [[eosio::table("candidates"), eosio::contract("auditorbos")]] candidate {
 
     uint64_t by_votes_rank() const { return static_cast<uint64_t>(UINT64_MAX - total_votes); }
 
+    // Active candidates first, each group ranked by votes.
+    uint128_t by_active_votes_rank() const { return combine_ids(is_active ? 0 : 1, by_votes_rank()); }
+
     EOSLIB_SERIALIZE(candidate,
                      (candidate_name)(locked_tokens)(total_votes)(is_active)(auditor_end_time_stamp))
 };
 
+// `byactiverank` takes the first index slot of the former `bycandidate` index, see `migrate`.
 typedef multi_index<"candidates"_n, candidate,
-        indexed_by<"bycandidate"_n, const_mem_fun<candidate, uint64_t, &candidate::primary_key> >,
+        indexed_by<"byactiverank"_n, const_mem_fun<candidate, uint128_t, &candidate::by_active_votes_rank> >,
         indexed_by<"byvotes"_n, const_mem_fun<candidate, uint64_t, &candidate::by_number_votes> >,
         indexed_by<"byvotesrank"_n, const_mem_fun<candidate, uint64_t, &candidate::by_votes_rank> >
 > candidates_table;
@@ -196,6 +212,19 @@ struct [[eosio::table("pendingstake"), eosio::contract("auditorbos")]] tempstake
 
 typedef multi_index<"pendingstake"_n, tempstake> pendingstake_table_t;
 
+/**
+ * - next_candidate (name) - The candidate the next `migrate` call starts from
+ * - done (bool) - Whether all the candidates have been moved to the current `candidates` indexes
+ */
+struct [[eosio::table("migration"), eosio::contract("auditorbos")]] migration_progress {
+    name next_candidate;
+    bool done = false;
+
+    EOSLIB_SERIALIZE(migration_progress, (next_candidate)(done))
+};
+
+typedef singleton<"migration"_n, migration_progress> migrationcontainer;
+
 
 class auditorbos : public contract {
 
@@ -205,7 +234,9 @@ private: // Variables used throughout the other actions.
     candidates_table registered_candidates;
     votes_table votes_cast_by_members;
     bios_table candidate_bios;
-    contr_state _currentState;
+    std::optional<contr_state> _currentState;
+    contr_state _loadedState;
+    std::optional<contr_config> _config;
 
 public:
 
@@ -215,13 +246,13 @@ public:
             votes_cast_by_members(_self, _self.value),
             candidate_bios(_self, _self.value),
             config_singleton(_self, _self.value),
-            contract_state(_self, _self.value) {
-
-        _currentState = contract_state.get_or_default(contr_state());
-    }
+            contract_state(_self, _self.value) {}
 
     ~auditorbos() {
-        contract_state.set(_currentState, _self); // This should not run during a contract_state migration since it will prevent changing the schema with data saved between runs.
+        // Only written back when an action changed it. This should not run during a contract_state migration since it will prevent changing the schema with data saved between runs.
+        if (_currentState && !(*_currentState == _loadedState)) {
+            contract_state.set(*_currentState, _self);
+        }
     }
 
     /**
@@ -252,18 +283,16 @@ public:
     ACTION updateconfig(contr_config newconfig);
 
     /**
-     * Action to listen to from the associated token contract to ensure registering should be allowed.
+     * Handler of the `transfer` notifications of the associated token contract to ensure registering should be allowed.
      *
-     * @param from The account to observe as the source of funds for a transfer
-     * @param to The account to observe as the destination of funds for a transfer
-     * @param quantity
-     * @param memo A string to attach to a transaction. For staking this string should match the name of the running contract eg "auditor.bos". Otherwise it will be regarded only as a generic transfer to the account.
-     * This action is intended only to observe transfers that are run by the associated token contract for the purpose of tracking the moving weights of votes if either the `from` or `to` in the transfer have active votes. It is not included in the ABI to prevent it from being called from outside the chain.
+     * Transfers to the contract are added to the `pendingstake` row of the sender. The action data (`from`, `to`,
+     * `quantity` and `memo`) is read directly, the contract is not constructed so no table other than `pendingstake`
+     * is opened and the state singleton is neither read nor written.
+     * It is not included in the ABI to prevent it from being called from outside the chain.
+     *
+     * @param self The account running this contract
      */
-    void transfer(name from,
-                  name to,
-                  asset quantity,
-                  string memo);
+    static void ontransfer(name self);
 
 
     /**
@@ -435,14 +464,34 @@ public:
      */
     ACTION unstake(name cand);
 
+    /**
+     * This action moves the candidates written with the former `bycandidate` index to the current indexes.
+     *
+     * Each candidate is erased with the former index layout, which releases its `bycandidate` entry, and emplaced
+     * again so it gets its `byactiverank` entry. Migrated candidates are billed to the contract account.
+     *
+     * ### Assertions:
+     * - The action is authorised by the contract account.
+     * - The migration has not completed yet.
+     *
+     * @param batch_size - The maximum number of candidates moved by this call.
+     *
+     * ### Post Condition:
+     * Up to `batch_size` more candidates are migrated. Once the last one is, the `migration` singleton is marked done
+     * and elections can run again.
+     */
+    ACTION migrate(uint16_t batch_size);
+
 
 private: // Private helper methods used by other actions.
 
-    contr_config configs();
+    // Loaded on first use and kept for the rest of the action, only `updateconfig` writes the configuration.
+    const contr_config &configs();
 
-    void updateVoteWeight(name auditor, int64_t weight);
+    // Loaded on first use, the destructor persists it when it differs from what was loaded.
+    contr_state &state();
 
-    void updateVoteWeights(const vector<name> &votes, int64_t vote_weight);
+    void updateVoteWeight(name auditor, int64_t weight);
 
     void modifyVoteWeights(name voter, vector<name> newVotes);
 
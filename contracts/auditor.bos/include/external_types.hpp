@@ -22,6 +22,18 @@ struct currency_stats {
 
 typedef eosio::multi_index<"stat"_n, currency_stats> stats;
 
+/**
+ * Data of the token contract's `transfer` action, read by the notification handler.
+ */
+struct transfer_args {
+    name from;
+    name to;
+    asset quantity;
+    string memo;
+
+    EOSLIB_SERIALIZE(transfer_args, (from)(to)(quantity)(memo))
+};
+
 /**
  * Every user 'from' has a scope/table that uses every receipient 'to' as the primary key.
  */
@@ -11,9 +11,7 @@
 #include "update_member_details.cpp"
 #include "registering.cpp"
 #include "voting.cpp"
-#ifdef MIGRATE
 #include "migration.cpp"
-#endif
 #include "privatehelpers.cpp"
 #include "newtenure_components.cpp"
 #include "external_observable_actions.cpp"
@@ -30,7 +28,12 @@ extern "C" { \
          check(code == "eosio"_n.value, "onerror action's are only valid from the \"eosio\" system account"); \
       } \
       auto self = receiver; \
-      if( (code == self  && action != "transfer"_n.value) || (code == name(TOKEN_CONTRACT).value && action == "transfer"_n.value) ) { \
+      if( code == name(TOKEN_CONTRACT).value && action == "transfer"_n.value ) { \
+         /* Fast path for deposits, only `pendingstake` is touched so the contract is not constructed */ \
+         TYPE::ontransfer(name(self)); \
+         return; \
+      } \
+      if( code == self && action != "transfer"_n.value ) { \
          switch( action ) { \
             EOSIO_DISPATCH_HELPER( TYPE, MEMBERS ) \
          } \
@@ -45,8 +48,5 @@ EOSIO_ABI_EX(auditorbos,
              (updatebio)
              (voteauditor)(refreshvote)
              (newtenure)
-             (transfer)
-#ifdef MIGRATE
              (migrate)
-#endif
 )
@@ -10,5 +10,13 @@ void auditorbos::updateconfig(contr_config new_config) {
     check(new_config.auth_threshold_auditors < new_config.numelected,
                  "ERR::UPDATECONFIG_INVALID_AUTH_AUDITORS_TO_NUM_ELECTED::The auth threshold can never be satisfied with a value greater than the number of elected auditors");
 
+    // A fresh deployment has no candidate written with the former indexes, nothing to migrate
+    if (!config_singleton.exists() && registered_candidates.begin() == registered_candidates.end()) {
+        migration_progress progress;
+        progress.done = true;
+        migrationcontainer(_self, _self.value).set(progress, _self);
+    }
+
     config_singleton.set(new_config, _self);
+    _config = new_config;
 }
@@ -1,22 +1,18 @@
 
-void auditorbos::transfer(name from,
-                            name to,
-                            asset quantity,
-                            string memo) {
-    if (to == _self) {
-        pendingstake_table_t pendingstake(_self, _self.value);
-        auto source = pendingstake.find(from.value);
-        if (source != pendingstake.end()) {
-            pendingstake.modify(source, _self, [&](tempstake &s) {
-                s.quantity += quantity;
-            });
-        } else {
-            pendingstake.emplace(_self, [&](tempstake &s) {
-                s.sender = from;
-                s.quantity = quantity;
-                s.memo = memo;
-            });
-        }
+void auditorbos::ontransfer(name self) {
+    const auto transfer = unpack_action_data<transfer_args>();
+
+    if (transfer.to == self) {
+        pendingstake_table_t pendingstake(self, self.value);
+        upsert(pendingstake, transfer.from.value, self, [&](tempstake &s, bool created) {
+            if (created) {
+                s.sender = transfer.from;
+                s.quantity = transfer.quantity;
+                s.memo = transfer.memo;
+            } else {
+                s.quantity += transfer.quantity;
+            }
+        });
     }
 
     //TODO: We can't listen to all EOSIO transfers without system contract changes
@@ -30,14 +26,14 @@ void auditorbos::transfer(name from,
     //     auto existingVote = votes_cast_by_members.find(from.value);
     //     if (existingVote != votes_cast_by_members.end()) {
     //         updateVoteWeights(existingVote->candidates, -quantity.amount);
-    //         _currentState.total_weight_of_votes -= quantity.amount;
+    //         state().total_weight_of_votes -= quantity.amount;
     //     }
 
     //     // Update vote weight for the 'to' in the transfer if vote exists
     //     existingVote = votes_cast_by_members.find(to.value);
     //     if (existingVote != votes_cast_by_members.end()) {
     //         updateVoteWeights(existingVote->candidates, quantity.amount);
-    //         _currentState.total_weight_of_votes += quantity.amount;
+    //         state().total_weight_of_votes += quantity.amount;
     //     }
     // }
 }
@@ -0,0 +1,33 @@
+// Layout of the `candidates` table before `byactiverank`, `bycandidate` duplicated the primary key.
+typedef multi_index<"candidates"_n, candidate,
+        indexed_by<"bycandidate"_n, const_mem_fun<candidate, uint64_t, &candidate::primary_key> >,
+        indexed_by<"byvotes"_n, const_mem_fun<candidate, uint64_t, &candidate::by_number_votes> >,
+        indexed_by<"byvotesrank"_n, const_mem_fun<candidate, uint64_t, &candidate::by_votes_rank> >
+> candidates_table_v1;
+
+void auditorbos::migrate(uint16_t batch_size) {
+    require_auth(_self);
+    check(batch_size > 0, "ERR::MIGRATE_INVALID_BATCH_SIZE::The batch size must be greater than 0.");
+
+    migrationcontainer migration(_self, _self.value);
+    migration_progress progress = migration.get_or_default(migration_progress());
+    check(!progress.done, "ERR::MIGRATE_ALREADY_DONE::All the candidates have already been migrated.");
+
+    candidates_table_v1 former_candidates(_self, _self.value);
+    auto cand_itr = former_candidates.lower_bound(progress.next_candidate.value);
+
+    for (uint16_t count = 0; count < batch_size && cand_itr != former_candidates.end(); count++) {
+        const candidate cand = *cand_itr;
+        cand_itr = former_candidates.erase(cand_itr);
+
+        registered_candidates.emplace(_self, [&](candidate &c) {
+            c = cand;
+        });
+    }
+
+    progress.done = cand_itr == former_candidates.end();
+    progress.next_candidate = progress.done ? name{0} : cand_itr->candidate_name;
+    migration.set(progress, _self);
+
+    eosio::print("Migrated candidates up to: ", progress.next_candidate, " done: ", progress.done);
+}
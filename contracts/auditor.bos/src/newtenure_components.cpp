@@ -1,6 +1,6 @@
 void auditorbos::assertPeriodTime() {
     uint32_t timestamp = now();
-    uint32_t periodBlockCount = timestamp - _currentState.lastperiodtime;
+    uint32_t periodBlockCount = timestamp - state().lastperiodtime;
     check(periodBlockCount > configs().auditor_tenure,
                  "ERR::NEWTENURE_EARLY::New period is being called too soon. Wait until the period has completed.");
 }
@@ -9,11 +9,16 @@ void auditorbos::allocateAuditors(bool early_election) {
 
     eosio::print("Configure auditors for the next period.");
 
+    // Candidates not migrated yet are missing from `byactiverank`
+    check(migrationcontainer(_self, _self.value).get_or_default(migration_progress()).done,
+          "ERR::ALLOCATEAUDITORS_MIGRATION_PENDING::The candidates migration must complete before auditors are allocated.");
+
     auditors_table auditors(_self, _self.value);
-    auto byvotes = registered_candidates.get_index<"byvotesrank"_n>();
-    auto cand_itr = byvotes.begin();
+    auto byactiverank = registered_candidates.get_index<"byactiverank"_n>();
+    auto cand_itr = byactiverank.begin();
 
-    int32_t electcount = configs().numelected;
+    const contr_config &config = configs();
+    int32_t electcount = config.numelected;
     uint8_t currentAuditorCount = 0;
 
     if (!early_election) {
@@ -21,9 +26,9 @@ void auditorbos::allocateAuditors(bool early_election) {
         auto auditor_itr = auditors.begin();
         while (auditor_itr != auditors.end()) {
             const auto &reg_candidate = registered_candidates.get(auditor_itr->auditor_name.value, "ERR::NEWTENURE_EXPECTED_CAND_NOT_FOUND::Corrupt data: Trying to set a lockup delay on candidate leaving office.");
-            registered_candidates.modify(reg_candidate, auditor_itr->auditor_name, [&](candidate &c) {
+            registered_candidates.modify(reg_candidate, same_payer, [&](candidate &c) {
                 eosio::print("Lockup stake for release delay.");
-                c.auditor_end_time_stamp = time_point_sec(now() + configs().lockup_release_time_delay);
+                c.auditor_end_time_stamp = time_point_sec(now() + config.lockup_release_time_delay);
             });
             auditor_itr = auditors.erase(auditor_itr);
         }
@@ -33,13 +38,14 @@ void auditorbos::allocateAuditors(bool early_election) {
     for (auto itr = auditors.begin(); itr != auditors.end(); itr++) { ++currentAuditorCount; }
 
     while (currentAuditorCount < electcount) {
-        if (cand_itr == byvotes.end() || cand_itr->total_votes == 0) {
+        // Inactive candidates are ranked after all the active ones, reaching one ends the pool.
+        if (cand_itr == byactiverank.end() || !cand_itr->is_active || cand_itr->total_votes == 0) {
             eosio::print("The pool of eligible candidates has been exhausted");
             return;
         }
 
-        //  If the candidate is inactive or is already a auditor skip to the next one.
-        if (!cand_itr->is_active || auditors.find(cand_itr->candidate_name.value) != auditors.end()) {
+        //  If the candidate is already a auditor skip to the next one.
+        if (auditors.find(cand_itr->candidate_name.value) != auditors.end()) {
             cand_itr++;
         } else {
             auditors.emplace(_self, [&](auditor &c) {
@@ -47,9 +53,9 @@ void auditorbos::allocateAuditors(bool early_election) {
                 c.total_votes = cand_itr->total_votes;
             });
 
-            byvotes.modify(cand_itr, cand_itr->candidate_name, [&](candidate &c) {
+            byactiverank.modify(cand_itr, same_payer, [&](candidate &c) {
                     eosio::print("Lockup stake for release delay.");
-                    c.auditor_end_time_stamp = time_point_sec(now() + configs().lockup_release_time_delay);
+                    c.auditor_end_time_stamp = time_point_sec(now() + config.lockup_release_time_delay);
             });
 
             currentAuditorCount++;
@@ -98,7 +104,7 @@ void auditorbos::newtenure(string message) {
 
     print("\nPeriodTime");
 
-    contr_config config = configs();
+    const contr_config &config = configs();
 
     print("\nConfigs");
 
@@ -110,20 +116,20 @@ void auditorbos::newtenure(string message) {
     print("\nRead stats");
 
     double percent_of_current_voter_engagement =
-            double(_currentState.total_weight_of_votes) / double(max_supply) * 100.0;
+            double(state().total_weight_of_votes) / double(max_supply) * 100.0;
 
-    eosio::print("\n\nToken max supply: ", max_supply, " total votes so far: ", _currentState.total_weight_of_votes);
+    eosio::print("\n\nToken max supply: ", max_supply, " total votes so far: ", state().total_weight_of_votes);
     eosio::print("\n\nNeed inital engagement of: ", config.initial_vote_quorum_percent, "% to start the Audit Cycle.");
-    eosio::print("\n\nToken supply: ", max_supply * 0.0001, " total votes so far: ", _currentState.total_weight_of_votes * 0.0001);
+    eosio::print("\n\nToken supply: ", max_supply * 0.0001, " total votes so far: ", state().total_weight_of_votes * 0.0001);
     eosio::print("\n\nNeed initial engagement of: ", config.initial_vote_quorum_percent, "% to start the Audit Cycle..");
     eosio::print("\n\nNeed ongoing engagement of: ", config.vote_quorum_percent,
                  "% to allow new periods to trigger after initial activation.");
     eosio::print("\n\nPercent of current voter engagement: ", percent_of_current_voter_engagement, "\n\n");
 
-    check(_currentState.met_initial_votes_threshold == true ||
+    check(state().met_initial_votes_threshold == true ||
                  percent_of_current_voter_engagement > config.initial_vote_quorum_percent,
                  "ERR::NEWTENURE_VOTER_ENGAGEMENT_LOW_ACTIVATE::Voter engagement is insufficient to activate the Audit Cycle..");
-    _currentState.met_initial_votes_threshold = true;
+    state().met_initial_votes_threshold = true;
 
     check(percent_of_current_voter_engagement > config.vote_quorum_percent,
                  "ERR::NEWTENURE_VOTER_ENGAGEMENT_LOW_PROCESS::Voter engagement is insufficient to process a new period");
@@ -134,7 +140,7 @@ void auditorbos::newtenure(string message) {
     // Set the auths on the BOS auditor authority account
     setAuditorAuths();
 
-    _currentState.lastperiodtime = now();
+    state().lastperiodtime = now();
 
 
 //        Schedule the the next election cycle at the end of the period.
@@ -1,8 +1,17 @@
 
-contr_config auditorbos::configs() {
-    contr_config conf = config_singleton.get_or_default(contr_config());
-    config_singleton.set(conf, _self);
-    return conf;
+const contr_config &auditorbos::configs() {
+    if (!_config) {
+        _config = config_singleton.get_or_default(contr_config());
+    }
+    return *_config;
+}
+
+contr_state &auditorbos::state() {
+    if (!_currentState) {
+        _loadedState = contract_state.get_or_default(contr_state());
+        _currentState = _loadedState;
+    }
+    return *_currentState;
 }
 
 void auditorbos::updateVoteWeight(name auditor, int64_t weight) {
@@ -16,22 +25,13 @@ void auditorbos::updateVoteWeight(name auditor, int64_t weight) {
         return; // trying to avoid throwing errors from here since it's unrelated to a transfer action.?!?!?!?!
     }
 
-    registered_candidates.modify(candItr, auditor, [&](auto &c) {
+    registered_candidates.modify(candItr, same_payer, [&](auto &c) {
         c.total_votes += weight;
         eosio::print("\nchanging vote weight: ", auditor, " by ", weight);
     });
 }
 
-void auditorbos::updateVoteWeights(const vector<name> &votes, int64_t vote_weight) {
-    for (const auto &auditor : votes) {
-        updateVoteWeight(auditor, vote_weight);
-    }
-
-    _currentState.total_votes_on_candidates += votes.size() * vote_weight;
-}
-
 void auditorbos::modifyVoteWeights(name voter, vector<name> newVotes) {
-    // This could be optimised with set diffing to avoid remove then add for unchanged votes. - later
     eosio::print("Modify vote weights: ", voter, "\n");
 
     uint64_t asset_name = configs().lockupasset.symbol.code().raw();
@@ -84,13 +84,34 @@ void auditorbos::modifyVoteWeights(name voter, vector<name> newVotes) {
 
     // New voter -> Add the tokens to the total weight.
     if (oldVotes.size() == 0)
-        _currentState.total_weight_of_votes += vote_weight;
+        state().total_weight_of_votes += vote_weight;
 
     // Leaving voter -> Remove the tokens to the total weight.
     if (newVotes.size() == 0)
-        _currentState.total_weight_of_votes -= old_weight;
+        state().total_weight_of_votes -= old_weight;
+
+    // Net delta per candidate, a candidate kept across both votes only moves by the change of weight.
+    vector<pair<name, int64_t>> deltas;
+    deltas.reserve(oldVotes.size() + newVotes.size());
+    for (const auto &auditor : oldVotes) {
+        deltas.emplace_back(auditor, -old_weight);
+    }
+    for (const auto &auditor : newVotes) {
+        auto delta = find_if(deltas.begin(), deltas.end(), [&](const auto &d) { return d.first == auditor; });
+        if (delta != deltas.end()) {
+            delta->second += vote_weight;
+        } else {
+            deltas.emplace_back(auditor, vote_weight);
+        }
+    }
+
+    // Each affected candidate is written once, unchanged ones are not written at all.
+    for (const auto &delta : deltas) {
+        if (delta.second != 0) {
+            updateVoteWeight(delta.first, delta.second);
+        }
+    }
 
-    updateVoteWeights(oldVotes, -old_weight); //remove old weights
-    updateVoteWeights(newVotes, vote_weight); //add new weights
+    state().total_votes_on_candidates += int64_t(newVotes.size()) * vote_weight - int64_t(oldVotes.size()) * old_weight;
 }
 
@@ -3,7 +3,7 @@
 void auditorbos::nominatecand(name cand) {
     require_auth(cand);
 
-    _currentState.number_active_candidates++;
+    state().number_active_candidates++;
 
     pendingstake_table_t pendingstake(_self, _self.value);
     auto pending = pendingstake.find(cand.value);
@@ -51,7 +51,7 @@ void auditorbos::unstake(name cand) {
 
     check(reg_candidate.auditor_end_time_stamp < time_point_sec(now()), "ERR::UNSTAKE_CANNOT_UNSTAKE_UNDER_TIME_LOCK::Cannot unstake tokens before they are unlocked from the time delay.");
 
-    registered_candidates.modify(reg_candidate, cand, [&](candidate &c) {
+    registered_candidates.modify(reg_candidate, same_payer, [&](candidate &c) {
         // Ensure the candidate's tokens are not locked up for a time delay period.
         // Send back the locked up tokens
         // inline transfer unstaking
@@ -98,13 +98,13 @@ void auditorbos::removeAuditor(name auditor) {
 }
 
 void auditorbos::removeCandidate(name cand, bool lockupStake) {
-    _currentState.number_active_candidates--;
+    state().number_active_candidates--;
 
     const auto &reg_candidate = registered_candidates.get(cand.value, "ERR::REMOVECANDIDATE_NOT_CURRENT_CANDIDATE::Candidate is not already registered.");
 
     eosio::print("Remove from nominated candidate by setting them to inactive.");
     // Set the is_active flag to false instead of deleting in order to retain votes if they return as BOS auditors.
-    registered_candidates.modify(reg_candidate, cand, [&](candidate &c) {
+    registered_candidates.modify(reg_candidate, same_payer, [&](candidate &c) {
         c.is_active = 0;
         if (lockupStake) {
             eosio::print("Lockup stake for release delay.");
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Find-or-emplace helpers for `multi_index` tables
+ *
+ * The callable is a template parameter and is invoked directly, no `std::function` wrapper is
+ * involved. Header-only and independent of the eosio.cdt headers so every contract can use it
+ * whatever `eosio` / `eosiolib` flavor it includes.
+ */
+
+/**
+ * Applies `updater(row, created)` to the row keyed by `primary_key`, emplacing it first when
+ * missing. `payer` pays for the RAM of the new row, or becomes the payer of the updated one.
+ *
+ * Returns `true` when the row was created.
+ */
+template <typename Table, typename Payer, typename Updater>
+bool upsert(Table& table, const uint64_t primary_key, const Payer& payer, Updater&& updater) {
+    auto itr = table.find(primary_key);
+    if (itr == table.end()) {
+        table.emplace(payer, [&](auto& row) { updater(row, true); });
+        return true;
+    }
+
+    table.modify(itr, payer, [&](auto& row) { updater(row, false); });
+    return false;
+}
+
+/**
+ * Applies `updater(row)` to the row keyed by `primary_key` if it exists, see `upsert` for `payer`.
+ *
+ * Returns `true` when the row was found.
+ */
+template <typename Table, typename Payer, typename Updater>
+bool update_if_found(Table& table, const uint64_t primary_key, const Payer& payer, Updater&& updater) {
+    auto itr = table.find(primary_key);
+    if (itr == table.end()) return false;
+
+    table.modify(itr, payer, [&](auto& row) { updater(row); });
+    return true;
+}
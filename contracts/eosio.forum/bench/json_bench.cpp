@@ -0,0 +1,61 @@
+/**
+ * Native micro-benchmark of `json::validate` (include/json.hpp) on generated JSON objects
+ *
+ * Not part of the contract build, compile and run it from this directory with:
+ *
+ *     g++ -O2 -std=c++17 -I ../include json_bench.cpp -o json_bench && ./json_bench
+ *
+ * Prints the average time of one validation for each payload size. Timings are native, the
+ * WASM execution on chain is slower by a constant factor, the relative costs still hold.
+ */
+#include <json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Object mixing the value kinds found in proposal and vote payloads, padded to exactly `size` bytes
+static std::string make_payload(const size_t size) {
+    std::string out = "{";
+    for (uint32_t i = 0; out.size() + 96 < size; i++) {
+        if (i > 0) out += ",";
+        out += "\"field_" + std::to_string(i) + "\":{\"title\":\"Entry \\\"" + std::to_string(i) + "\\\" \\u00e9\","
+            "\"amount\":-" + std::to_string(i) + ".25e3,\"flags\":[true,false,null]}";
+    }
+
+    out += ",\"pad\":\"";
+    out.append(size - out.size() - 2, 'x');
+    out += "\"}";
+    return out;
+}
+
+int main() {
+    // 32767 is the largest `proposal_json` accepted by `VALIDATE_JSON(proposal_json, 32768)`
+    const size_t sizes[] = {1024, 8192, 32767};
+    const uint32_t iterations = 2000;
+
+    std::printf("%10s %12s\n", "bytes", "us/validate");
+    for (const size_t size : sizes) {
+        const std::string payload = make_payload(size);
+        if (!json::validate(payload.data(), payload.size())) {
+            std::printf("generated payload of %zu bytes is not valid JSON\n", size);
+            return 1;
+        }
+
+        // Read through a volatile so the optimizer cannot hoist the validation out of the loop
+        const char* volatile data = payload.data();
+
+        uint32_t valid = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            valid += json::validate(data, payload.size());
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        if (valid != iterations) return 1;
+
+        const double us = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+        std::printf("%10zu %12.2f\n", payload.size(), us);
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * Native micro-benchmark of the `lz` codec (include/lz.hpp): CPU spent against RAM saved
+ *
+ * Not part of the contract build, compile and run it from this directory with:
+ *
+ *     g++ -O2 -std=c++17 -I ../include lz_bench.cpp -o lz_bench && ./lz_bench
+ *
+ * The sample text (by default the repository's proposal example) is repeated up to each payload
+ * size, the largest one being the biggest `proposal_json` accepted by `propose`. Every payload is
+ * round-tripped through `lz::decompress` and checked against the original before being timed.
+ */
+#include <lz.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+template <typename Callback>
+static double time_us(const uint32_t iterations, Callback&& callback) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) callback();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "../../../Proposal Structure Example.md";
+
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string sample = buffer.str();
+    if (sample.empty()) {
+        std::printf("cannot read sample text from %s\n", path);
+        return 1;
+    }
+
+    const uint32_t sizes[] = {1024, 4096, 8192, 16384, 32767};
+    const uint32_t iterations = 500;
+
+    std::printf("%8s %12s %10s %12s %15s\n", "bytes", "compressed", "ram saved", "compress us", "decompress us");
+    for (const uint32_t size : sizes) {
+        std::string payload;
+        while (payload.size() < size) payload += sample;
+        payload.resize(size);
+
+        const std::vector<char> compressed = lz::compress(payload.data(), size);
+
+        std::string restored;
+        if (!lz::decompress(compressed.data(), compressed.size(), restored) || restored != payload) {
+            std::printf("round trip failed for %u bytes\n", size);
+            return 1;
+        }
+
+        // Read through a volatile so the optimizer cannot hoist the work out of the timed loops
+        const char* volatile data = payload.data();
+        const char* volatile packed = compressed.data();
+
+        size_t sink = 0;
+        const double compress_us = time_us(iterations, [&]() {
+            sink += lz::compress(data, size).size();
+        });
+        const double decompress_us = time_us(iterations, [&]() {
+            sink += lz::decompress(packed, compressed.size(), restored);
+        });
+        if (sink == 0) return 1;
+
+        std::printf(
+            "%8u %12zu %10lld %12.1f %15.1f\n",
+            size,
+            compressed.size(),
+            (long long) size - (long long) compressed.size(),
+            compress_us,
+            decompress_us
+        );
+    }
+
+    return 0;
+}
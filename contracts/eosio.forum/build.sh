@@ -1,4 +1,4 @@
 #!/usr/bin/env bash
 
 cd src
-eosio-cpp forum.cpp -o ../forum.wasm -abigen -I ../include -R ../resources
+cdt-cpp forum.cpp -o ../forum.wasm -abigen -I ../include -I ../../common/include -R ../resources
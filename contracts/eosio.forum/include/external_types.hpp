@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <eosio/asset.hpp>
+#include <eosio/eosio.hpp>
+
+/**
+ * Tables of the `eosio` system contract read by the forum, only used for stake lookups.
+ */
+namespace eosiosystem {
+
+    struct voter_info {
+        eosio::name                owner;
+        eosio::name                proxy;
+        std::vector<eosio::name>   producers;
+        int64_t                    staked = 0;
+        double                     last_vote_weight = 0;
+        double                     proxied_vote_weight = 0;
+        bool                       is_proxy = 0;
+        uint32_t                   flags1 = 0;
+        uint32_t                   reserved2 = 0;
+        eosio::asset               reserved3;
+
+        uint64_t primary_key() const { return owner.value; }
+    };
+
+    typedef eosio::multi_index<"voters"_n, voter_info> voters_table;
+
+    /**
+     * Every user 'from' has a scope/table that uses every receipient 'to' as the primary key.
+     */
+    struct delegated_bandwidth {
+        eosio::name                from;
+        eosio::name                to;
+        eosio::asset               net_weight;
+        eosio::asset               cpu_weight;
+
+        uint64_t primary_key() const { return to.value; }
+    };
+
+    typedef eosio::multi_index<"delband"_n, delegated_bandwidth> del_bandwidth_table;
+}
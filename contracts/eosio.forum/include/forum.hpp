@@ -1,33 +1,143 @@
 #pragma once
 
 #include <algorithm>
+#include <optional>
 #include <string>
 
+#include <eosio/binary_extension.hpp>
+#include <eosio/crypto.hpp>
 #include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
 #include <eosio/time.hpp>
 #include <eosio/system.hpp>
 
+#include "external_types.hpp"
+#include "json.hpp"
+#include "lz.hpp"
+#include "upsert.hpp"
+
+using eosio::binary_extension;
 using eosio::check;
+using eosio::checksum256;
 using eosio::const_mem_fun;
 using eosio::current_time_point;
 using eosio::datastream;
 using eosio::indexed_by;
 using eosio::name;
 using eosio::time_point_sec;
-using std::function;
+using std::optional;
 using std::string;
+using std::vector;
 
 class [[eosio::contract("forum")]] forum : public eosio::contract {
     public:
         forum(name receiver, name code, datastream<const char*> ds)
         :eosio::contract(receiver, code, ds)
         {}
+
+        ~forum() {
+            // Sequence state is written once per action, however many changes were logged
+            if (_changelog_state.has_value()) {
+                changelog_state_singleton(_self, _self.value).set(_changelog_state.value(), _self);
+            }
+
+            // Same for the gauge, loaded by the first row written or erased
+            if (_gauge.has_value()) {
+                _gauge->updated_at = current_time_point();
+                gauge_singleton(_self, _self.value).set(_gauge.value(), _self);
+            }
+        }
+
+        struct vote_entry {
+            name                 proposal_name;
+            uint8_t              vote;
+            string               vote_json;
+        };
+
+        // Fixed layout alternative to `vote_json`, decoded through the ABI instead of a JSON parser
+        struct ballot_options {
+            // Why the voter abstains, `0` when not abstaining
+            uint8_t              abstain_reason = 0;
+
+            // Account the voter delegates its vote to, empty when not delegating
+            name                 delegate;
+
+            // Bit `i` set when option `i` of a multiple choice proposal is selected
+            uint64_t             choices = 0;
+        };
+
+        struct [[eosio::table("config")]] config_row {
+            // Store only the digest of `proposal_json` & `vote_json`, their content stays in the action data
+            bool                 lean_payloads = false;
+
+            // Store `proposal_json` LZ compressed when it gets smaller (ignored in lean mode)
+            binary_extension<bool> compress_proposals;
+
+            // Bill the RAM of ballots and statuses to their voter/account instead of the contract
+            binary_extension<bool> voter_pays_ram;
+
+            // Number of most recent entries kept in the `changelog` table
+            binary_extension<uint64_t> changelog_capacity;
+
+            // Seconds after its last update a status can be removed by `sweepstatus`, `0` keeps statuses forever
+            binary_extension<uint32_t> status_ttl;
+        };
+        typedef eosio::singleton<"config"_n, config_row> config_singleton;
+
+        // Live number of rows and serialized bytes of a table, across all its scopes
+        struct table_usage {
+            name                 table;
+            uint64_t             rows;
+            uint64_t             bytes;
+        };
+
+        struct [[eosio::table("gauge")]] gauge_row {
+            vector<table_usage>  tables;
+            time_point_sec       updated_at;
+        };
+        typedef eosio::singleton<"gauge"_n, gauge_row> gauge_singleton;
+
+        // Result of `gettally`, weighted by stake once the proposal is finalized
+        struct tally_view {
+            name                 proposal_name;
+            vector<uint64_t>     votes;
+            uint64_t             total;
+            bool                 finalized;
+            vector<uint64_t>     weights;
+            uint64_t             total_weight;
+        };
+
+        struct ballot_view {
+            name                 voter;
+            uint8_t              vote;
+            int64_t              staked;
+            uint64_t             json_id;
+            time_point_sec       updated_at;
+            optional<ballot_options> options;
+        };
+
+        // Result of `getballots`, `next_voter` is the `cursor` of the next page when there is one
+        struct ballot_page {
+            vector<ballot_view>  ballots;
+            optional<name>       next_voter;
+        };
+
+        [[eosio::action]]
+        void updateconfig(const config_row& config);
+
+        [[eosio::action]]
+        void setgauge(const vector<table_usage>& tables);
+
+        [[eosio::action]]
+        void rebill(const name account, const vector<name>& proposal_names);
+
         [[eosio::action]]
         void propose(
             const name proposer,
             const name proposal_name,
             const string& title,
-            const string& proposal_json
+            const string& proposal_json,
+            const time_point_sec& expires_at
         );
 
         [[eosio::action]]
@@ -38,9 +148,29 @@ class [[eosio::contract("forum")]] forum : public eosio::contract {
             const string& vote_json
         );
 
+        [[eosio::action]]
+        void votetyped(
+            const name voter,
+            const name proposal_name,
+            uint8_t vote,
+            const ballot_options& options
+        );
+
+        [[eosio::action]]
+        void votebatch(const name voter, const vector<vote_entry>& entries);
+
         [[eosio::action]]
         void unvote(const name voter, const name proposal_name);
 
+        [[eosio::action]]
+        void unvoteall(const name voter, const uint64_t max_rows);
+
+        [[eosio::action]]
+        void refreshballot(const name voter, const name proposal_name);
+
+        [[eosio::action]]
+        void migrate(const uint64_t max_rows);
+
         [[eosio::action]]
         void post(
             const name poster,
@@ -58,13 +188,41 @@ class [[eosio::contract("forum")]] forum : public eosio::contract {
         [[eosio::action]]
         void status(const name account, const string& content);
 
+        [[eosio::action]]
+        void sweepstatus(const uint64_t max_rows);
+
         [[eosio::action]]
         void cancel(
             const name proposer,
             const name proposal_name
         );
 
+        [[eosio::action]]
+        void purge(const name proposal_name, const uint64_t max_rows);
+
+        [[eosio::action]]
+        void sweep(const uint64_t max_rows);
+
+        [[eosio::action]]
+        void finalize(const name proposal_name, const uint64_t max_rows);
+
+        [[eosio::action, eosio::read_only]]
+        tally_view gettally(const name proposal_name);
+
+        [[eosio::action, eosio::read_only]]
+        ballot_page getballots(const name proposal_name, const name cursor, const uint32_t limit);
+
     private:
+        constexpr static uint32_t SIX_MONTHS_IN_SECONDS = (uint32_t) (6 * (365.25 / 12) * 24 * 60 * 60);
+
+        // Number of votes removed inline by `cancel`, the rest is left to the `purge` action
+        constexpr static uint64_t CANCEL_PURGE_ROWS = 1500;
+
+        constexpr static uint64_t DEFAULT_CHANGELOG_CAPACITY = 10000;
+
+        // Largest page returned by `getballots`
+        constexpr static uint32_t MAX_BALLOT_PAGE = 1000;
+
         static uint128_t compute_by_proposal_key(const name proposal_name, const name voter) {
             return ((uint128_t) proposal_name.value) << 64 | voter.value;
         }
@@ -73,6 +231,15 @@ class [[eosio::contract("forum")]] forum : public eosio::contract {
             return ((uint128_t) voter.value) << 64 | proposal_name.value;
         }
 
+        struct payload_digest {
+            checksum256          hash;
+            uint32_t             size;
+        };
+
+        static payload_digest compute_digest(const string& payload) {
+            return {eosio::sha256(payload.data(), payload.size()), (uint32_t) payload.size()};
+        }
+
         struct [[eosio::table]] proposal_row {
             name                  proposal_name;
             name                  proposer;
@@ -80,14 +247,49 @@ class [[eosio::contract("forum")]] forum : public eosio::contract {
             string                proposal_json;
             time_point_sec        created_at;
 
+            // Proposals created before expiry was introduced have none and never expire
+            binary_extension<time_point_sec> expires_at;
+
+            // Only set when `proposal_json` is not stored verbatim, in which case `proposal_json` is empty
+            binary_extension<optional<payload_digest>> proposal_json_digest;
+
+            // When not empty, `proposal_json` compressed with the `lz` codec
+            binary_extension<vector<char>> proposal_json_lz;
+
             auto primary_key()const { return proposal_name.value; }
             uint64_t by_proposer() const { return proposer.value; }
+            uint64_t by_created() const { return created_at.sec_since_epoch(); }
+            uint64_t by_expiry() const {
+                return expires_at.has_value() ? expires_at.value().sec_since_epoch() : UINT64_MAX;
+            }
+
+            bool is_expired() const {
+                return expires_at.has_value() && current_time_point().sec_since_epoch() >= expires_at.value().sec_since_epoch();
+            }
         };
         typedef eosio::multi_index<
             "proposal"_n, proposal_row,
-            indexed_by<"byproposer"_n, const_mem_fun<proposal_row, uint64_t, &proposal_row::by_proposer>>
+            indexed_by<"byproposer"_n, const_mem_fun<proposal_row, uint64_t, &proposal_row::by_proposer>>,
+            indexed_by<"byexpiry"_n, const_mem_fun<proposal_row, uint64_t, &proposal_row::by_expiry>>,
+            indexed_by<"bycreated"_n, const_mem_fun<proposal_row, uint64_t, &proposal_row::by_created>>
         > proposals;
 
+        // What is left of an expired proposal once swept, its content is verifiable against `content_hash`
+        struct [[eosio::table]] archive_row {
+            name                  proposal_name;
+            name                  proposer;
+            string                title;
+            checksum256           content_hash;
+            vector<uint64_t>      votes;
+            uint64_t              total;
+            time_point_sec        created_at;
+            time_point_sec        expires_at;
+
+            auto primary_key() const { return proposal_name.value; }
+        };
+        typedef eosio::multi_index<"archive"_n, archive_row> archives;
+
+        // Legacy single scope storage of votes, rows are moved to `ballots` by the `migrate` action
         struct [[eosio::table]] vote_row {
             uint64_t               id;
             name                   proposal_name;
@@ -106,33 +308,286 @@ class [[eosio::contract("forum")]] forum : public eosio::contract {
             indexed_by<"byvoter"_n, const_mem_fun<vote_row, uint128_t, &vote_row::by_voter>>
         > votes;
 
+        // Scoped by `proposal_name`, a ballot is found directly by its `voter` primary key
+        struct [[eosio::table]] ballot_row {
+            name                   voter;
+            uint8_t                vote;
+            string                 vote_json;
+            time_point_sec         updated_at;
+
+            // Only set when `vote_json` was stored in lean mode, in which case `vote_json` is empty
+            binary_extension<optional<payload_digest>> vote_json_digest;
+
+            // Stake of `voter` when the ballot was cast or last refreshed, see `get_staked`
+            binary_extension<int64_t> staked;
+
+            // When not `0`, id of the `payloads` row holding `vote_json`, in which case `vote_json` is empty
+            binary_extension<uint64_t> json_id;
+
+            // Only set for votes cast through `votetyped`, in which case `vote_json` is empty
+            binary_extension<optional<ballot_options>> options;
+
+            auto primary_key() const { return voter.value; }
+        };
+        typedef eosio::multi_index<"ballot"_n, ballot_row> ballots;
+
+        // Interned `vote_json` bodies, shared by all the ballots holding the same content
+        struct [[eosio::table]] payload_row {
+            uint64_t             id;
+            checksum256          digest;
+            string               body;
+            uint64_t             refs;
+
+            auto primary_key() const { return id; }
+            checksum256 by_digest() const { return digest; }
+        };
+        typedef eosio::multi_index<
+            "payload"_n, payload_row,
+            indexed_by<"bydigest"_n, const_mem_fun<payload_row, checksum256, &payload_row::by_digest>>
+        > payloads;
+
         struct [[eosio::table]] status_row {
             name                 account;
             string               content;
             time_point_sec       updated_at;
 
             auto primary_key() const { return account.value; }
+            uint64_t by_updated() const { return updated_at.sec_since_epoch(); }
+        };
+        typedef eosio::multi_index<
+            "status"_n, status_row,
+            indexed_by<"byupdated"_n, const_mem_fun<status_row, uint64_t, &status_row::by_updated>>
+        > statuses;
+
+        // Progress of the one time pass giving the statuses written before `byupdated` their index entry
+        struct [[eosio::table("statussweep")]] status_sweep_row {
+            name                 next_account;
+            bool                 reindexed = false;
+        };
+        typedef eosio::singleton<"statussweep"_n, status_sweep_row> status_sweep_singleton;
+
+        // Progress of the `unvoteall` walk of a voter, scoped by voter and removed once the walk completes
+        struct [[eosio::table("unvoteall")]] unvoteall_row {
+            name                 next_legacy;
+            name                 next_proposal;
+            bool                 legacy_done = false;
+        };
+        typedef eosio::singleton<"unvoteall"_n, unvoteall_row> unvoteall_singleton;
+
+        struct [[eosio::table]] tally_row {
+            name                 proposal_name;
+            vector<uint64_t>     votes;
+            uint64_t             total;
+            time_point_sec       updated_at;
+
+            auto primary_key() const { return proposal_name.value; }
+
+            void add(const uint8_t vote, const uint64_t count = 1) {
+                if (votes.size() <= vote) votes.resize(vote + 1, 0);
+
+                votes[vote] += count;
+                total += count;
+            }
+
+            void remove(const uint8_t vote, const uint64_t count = 1) {
+                check(vote < votes.size() && votes[vote] >= count, "tally is out of sync with votes.");
+
+                votes[vote] -= count;
+                total -= count;
+            }
+        };
+        typedef eosio::multi_index<"tally"_n, tally_row> tallies;
+
+        // Partial sums of a stake weighted count in progress, ballots are walked in `voter` order
+        struct [[eosio::table]] finalizing_row {
+            name                 proposal_name;
+            name                 next_voter;
+            vector<uint64_t>     votes;
+            vector<uint64_t>     weights;
+            uint64_t             total;
+            uint64_t             total_weight;
+            time_point_sec       updated_at;
+
+            auto primary_key() const { return proposal_name.value; }
+
+            void add(const uint8_t vote, const uint64_t weight) {
+                if (votes.size() <= vote) votes.resize(vote + 1, 0);
+                if (weights.size() <= vote) weights.resize(vote + 1, 0);
+
+                votes[vote] += 1;
+                weights[vote] += weight;
+                total += 1;
+                total_weight += weight;
+            }
+        };
+        typedef eosio::multi_index<"finalizing"_n, finalizing_row> finalizings;
+
+        // Stake weighted result of an expired proposal, written once and never modified afterwards
+        struct [[eosio::table]] result_row {
+            name                 proposal_name;
+            vector<uint64_t>     votes;
+            vector<uint64_t>     weights;
+            uint64_t             total;
+            uint64_t             total_weight;
+            time_point_sec       finalized_at;
+
+            auto primary_key() const { return proposal_name.value; }
         };
-        typedef eosio::multi_index<"status"_n, status_row> statuses;
+        typedef eosio::multi_index<"result"_n, result_row> results;
 
-        void update_status(
-            statuses& status_table,
-            const name account,
-            const function<void(status_row&)> updater
+        // Tracks the removal of the votes of a proposal that no longer exists
+        struct [[eosio::table]] purge_row {
+            name                 proposal_name;
+            name                 next_voter;
+            uint64_t             erased;
+            uint64_t             remaining;
+            time_point_sec       updated_at;
+
+            auto primary_key() const { return proposal_name.value; }
+        };
+        typedef eosio::multi_index<"purge"_n, purge_row> purges;
+
+        // One entry per mutation of a proposal or a vote, indexers resume from the last `seq` they have seen
+        struct [[eosio::table]] change_row {
+            uint64_t             seq;
+            name                 action;
+            name                 proposal_name;
+            name                 account;
+            uint8_t              vote;
+            time_point_sec       created_at;
+
+            auto primary_key() const { return seq; }
+        };
+        typedef eosio::multi_index<"changelog"_n, change_row> changelog;
+
+        struct [[eosio::table("changestate")]] changelog_state_row {
+            uint64_t             next_seq = 0;
+        };
+        typedef eosio::singleton<"changestate"_n, changelog_state_row> changelog_state_singleton;
+
+        optional<config_row> _config;
+        optional<changelog_state_row> _changelog_state;
+        optional<gauge_row> _gauge;
+
+        // Entry of `table` in the gauge, loaded on first use and written back by the destructor
+        table_usage& get_usage(const name table);
+
+        // Records a row of `table` going from `before` to `after` serialized bytes, `0` standing for no row
+        void track_usage(const name table, const uint64_t before, const uint64_t after);
+
+        // Staked amount of `account` as counted by the system contract for producer votes,
+        // falling back to its self delegated bandwidth when it never voted for producers
+        int64_t get_staked(const name account);
+
+        // Returns the id of the `payloads` row holding `body`, adding a reference to it (`0` for an empty body)
+        uint64_t intern_payload(const string& body);
+
+        // Drops a reference to the `payloads` row `json_id`, erasing it with its last reference
+        void release_payload(const uint64_t json_id);
+
+        // Fills a `ballots` row from a legacy `votes` row being moved over
+        void copy_legacy_vote(ballot_row& row, const vote_row& legacy);
+
+        // Appends an entry to the `changelog` ring buffer, evicting the entries past its capacity
+        void log_change(const name action, const name proposal_name, const name account, const uint8_t vote = 0);
+
+        // Loaded on first use, the configuration does not change within an action
+        const config_row& get_config();
+
+        // Account paying for the RAM of the ballots and statuses owned by `account`
+        name ram_payer(const name account) {
+            return get_config().voter_pays_ram.value_or(false) ? account : _self;
+        }
+
+        // Whether `row` has its entry in the `byupdated` index, rows written before the index have none
+        bool is_status_indexed(statuses& status_table, const status_row& row);
+
+        // Whether `sweepstatus` completed its one time reindex, every status is in `byupdated` from then on
+        bool is_status_reindexed() {
+            return status_sweep_singleton(_self, _self.value).get_or_default(status_sweep_row()).reindexed;
+        }
+
+        template <typename Updater>
+        void update_status(statuses& status_table, const name account, Updater&& updater) {
+            // `modify` cannot move a row missing from `byupdated`, it is written again instead. The index
+            // range is only scanned until the reindex completes, a single singleton read afterwards.
+            auto itr = status_table.find(account.value);
+            if (itr != status_table.end() && !is_status_reindexed() && !is_status_indexed(status_table, *itr)) {
+                track_usage("status"_n, eosio::pack_size(*itr), 0);
+                status_table.erase(itr);
+            }
+
+            upsert(status_table, account.value, ram_payer(account), [&](auto& row, const bool created) {
+                const uint64_t before = created ? 0 : eosio::pack_size(row);
+                if (created) row.account = account;
+                row.updated_at = current_time_point();
+                updater(row);
+                track_usage("status"_n, before, eosio::pack_size(row));
+            });
+        }
+
+        // Records the vote of `voter` (already authorized) on `proposal_name`, shared by `vote` and `votebatch`
+        void cast_vote(
+            proposals& proposal_table,
+            votes& vote_table,
+            tallies& tally_table,
+            const name voter,
+            const name proposal_name,
+            const uint8_t vote,
+            const string& vote_json,
+            const optional<ballot_options>& options = optional<ballot_options>()
         );
 
-        void update_vote(
+        // Calls `updater(row, created)`, returns `true` when a new ballot row was created
+        template <typename Updater>
+        bool update_ballot(ballots& ballot_table, const name voter, Updater&& updater) {
+            return upsert(ballot_table, voter.value, ram_payer(voter), [&](auto& row, const bool created) {
+                const uint64_t before = created ? 0 : eosio::pack_size(row);
+                if (created) row.voter = voter;
+                row.updated_at = current_time_point();
+                updater(row, created);
+                track_usage("ballot"_n, before, eosio::pack_size(row));
+            });
+        }
+
+        // Records the final tally and content hash of an expired proposal, must be called before erasing it
+        void archive_proposal(const proposal_row& proposal);
+
+        // Counts at most `budget` more ballots of the expired `proposal_name` (decreasing `budget` accordingly),
+        // returns `true` once its `result` row exists
+        bool finalize_votes(const name proposal_name, uint64_t& budget);
+
+        // Starts the removal of the votes of `proposal_name`, must be called once the proposal is erased
+        void start_purge(const name proposal_name);
+
+        // Erases at most `max_rows` votes of the purged proposal, returns the number of rows erased
+        uint64_t purge_votes(purges& purge_table, const name proposal_name, const uint64_t max_rows);
+
+        // Erases the legacy `votes` row of the pair if any, returning `true` and its vote value when found
+        bool erase_legacy_vote(
             votes& vote_table,
             const name proposal_name,
             const name voter,
-            const function<void(vote_row&)> updater
+            uint8_t& previous_vote
         );
 
+        // Proposals created before the tally table existed have no running tally, they must be counted off-chain
+        template <typename Updater>
+        void update_tally(tallies& tally_table, const name proposal_name, Updater&& updater) {
+            update_if_found(tally_table, proposal_name.value, _self, [&](auto& row) {
+                const uint64_t before = eosio::pack_size(row);
+                row.updated_at = current_time_point();
+                updater(row);
+                track_usage("tally"_n, before, eosio::pack_size(row));
+            });
+        }
+
         // Do not use directly, use the VALIDATE_JSON macro instead!
         void validate_json(
             const string& payload,
             size_t max_size,
             const char* not_object_message,
-            const char* over_size_message
+            const char* over_size_message,
+            const char* malformed_message
         );
 };
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Structural JSON validator (RFC 8259) used by `VALIDATE_JSON`
+ *
+ * Single pass over the payload without any allocation: the kind of each open container
+ * (object or array) is kept as one bit of a 64-bit word, which bounds the nesting depth
+ * to `MAX_DEPTH`. Strings are checked for valid escapes and unescaped control characters,
+ * numbers against the JSON number grammar. UTF-8 sequences are not validated.
+ */
+namespace json {
+    constexpr uint32_t MAX_DEPTH = 64;
+
+    namespace detail {
+        inline bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+
+        inline bool is_hex(const char c) {
+            return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }
+
+        // `pos` is on the opening quote, left after the closing quote
+        inline bool scan_string(const char* data, const size_t size, size_t& pos) {
+            pos++;
+            while (pos < size) {
+                const unsigned char c = data[pos++];
+                if (c == '"') return true;
+                if (c < 0x20) return false;
+                if (c != '\\') continue;
+
+                if (pos >= size) return false;
+                const char escaped = data[pos++];
+                if (escaped == 'u') {
+                    if (pos + 4 > size) return false;
+                    for (size_t i = 0; i < 4; i++) {
+                        if (!is_hex(data[pos++])) return false;
+                    }
+                } else if (escaped != '"' && escaped != '\\' && escaped != '/' && escaped != 'b' &&
+                           escaped != 'f' && escaped != 'n' && escaped != 'r' && escaped != 't') {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        inline bool scan_number(const char* data, const size_t size, size_t& pos) {
+            if (pos < size && data[pos] == '-') pos++;
+            if (pos >= size) return false;
+
+            if (data[pos] == '0') {
+                pos++;
+            } else if (is_digit(data[pos])) {
+                while (pos < size && is_digit(data[pos])) pos++;
+            } else {
+                return false;
+            }
+
+            if (pos < size && data[pos] == '.') {
+                pos++;
+                if (pos >= size || !is_digit(data[pos])) return false;
+                while (pos < size && is_digit(data[pos])) pos++;
+            }
+
+            if (pos < size && (data[pos] == 'e' || data[pos] == 'E')) {
+                pos++;
+                if (pos < size && (data[pos] == '+' || data[pos] == '-')) pos++;
+                if (pos >= size || !is_digit(data[pos])) return false;
+                while (pos < size && is_digit(data[pos])) pos++;
+            }
+
+            return true;
+        }
+
+        inline bool scan_literal(const char* data, const size_t size, size_t& pos, const char* literal, const size_t length) {
+            if (pos + length > size) return false;
+            for (size_t i = 0; i < length; i++) {
+                if (data[pos + i] != literal[i]) return false;
+            }
+            pos += length;
+            return true;
+        }
+
+        inline bool scan_scalar(const char* data, const size_t size, size_t& pos) {
+            switch (data[pos]) {
+                case '"': return scan_string(data, size, pos);
+                case 't': return scan_literal(data, size, pos, "true", 4);
+                case 'f': return scan_literal(data, size, pos, "false", 5);
+                case 'n': return scan_literal(data, size, pos, "null", 4);
+                default: return scan_number(data, size, pos);
+            }
+        }
+    }
+
+    // Returns `true` when `data` holds exactly one well-formed JSON value nested at most `max_depth` levels
+    inline bool validate(const char* data, const size_t size, const uint32_t max_depth = MAX_DEPTH) {
+        enum state_t {
+            EXPECT_VALUE,
+            EXPECT_VALUE_OR_CLOSE,
+            EXPECT_KEY,
+            EXPECT_KEY_OR_CLOSE,
+            EXPECT_COLON,
+            EXPECT_COMMA_OR_CLOSE,
+            DONE
+        };
+
+        // Bit `i` is set when the container opened at depth `i + 1` is an object
+        uint64_t objects = 0;
+        uint32_t depth = 0;
+        const uint32_t depth_limit = max_depth < MAX_DEPTH ? max_depth : MAX_DEPTH;
+
+        const auto in_object = [&]() { return ((objects >> (depth - 1)) & 1) == 1; };
+
+        state_t state = EXPECT_VALUE;
+        size_t pos = 0;
+        while (true) {
+            while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r')) pos++;
+            if (pos >= size) return state == DONE;
+
+            const char c = data[pos];
+            switch (state) {
+                case DONE:
+                    return false;
+
+                case EXPECT_COLON:
+                    if (c != ':') return false;
+                    pos++;
+                    state = EXPECT_VALUE;
+                    continue;
+
+                case EXPECT_KEY_OR_CLOSE:
+                case EXPECT_KEY:
+                    if (c == '}' && state == EXPECT_KEY_OR_CLOSE) break;
+                    if (c != '"' || !detail::scan_string(data, size, pos)) return false;
+                    state = EXPECT_COLON;
+                    continue;
+
+                case EXPECT_COMMA_OR_CLOSE:
+                    if (c == ',') {
+                        pos++;
+                        state = in_object() ? EXPECT_KEY : EXPECT_VALUE;
+                        continue;
+                    }
+                    if (c != (in_object() ? '}' : ']')) return false;
+                    break;
+
+                case EXPECT_VALUE_OR_CLOSE:
+                case EXPECT_VALUE:
+                    if (c == ']' && state == EXPECT_VALUE_OR_CLOSE) break;
+
+                    if (c == '{' || c == '[') {
+                        if (depth >= depth_limit) return false;
+
+                        const uint64_t bit = uint64_t(1) << depth;
+                        objects = c == '{' ? objects | bit : objects & ~bit;
+                        depth++;
+                        pos++;
+                        state = c == '{' ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+                        continue;
+                    }
+
+                    if (!detail::scan_scalar(data, size, pos)) return false;
+                    state = depth == 0 ? DONE : EXPECT_COMMA_OR_CLOSE;
+                    continue;
+            }
+
+            // Closing the current container
+            pos++;
+            depth--;
+            state = depth == 0 ? DONE : EXPECT_COMMA_OR_CLOSE;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal LZSS codec used to store large `proposal_json` compressed
+ *
+ * Format: the original size as 4 bytes little-endian, followed by groups made of one flag byte
+ * and up to 8 items. Bit `i` (least significant first) of the flag byte tells whether the `i`-th
+ * item is a literal (`0`, one byte) or a match (`1`, two bytes). A match encodes a distance of
+ * `1` to `WINDOW_SIZE` bytes back (12 bits, stored minus one) and a length of `MIN_MATCH` to
+ * `MAX_MATCH` bytes (4 bits, stored minus `MIN_MATCH`):
+ *
+ *     byte 0: distance bits 0-7
+ *     byte 1: distance bits 8-11 (high nibble) | length (low nibble)
+ *
+ * Both directions run in linear time, the compressor keeps a single 4096 entries hash table.
+ * The decoder is mirrored off-chain in `vote-tally/src/utils.ts` (`decompressProposalJson`).
+ */
+namespace lz {
+    constexpr uint32_t WINDOW_SIZE = 4096;
+    constexpr uint32_t MIN_MATCH = 3;
+    constexpr uint32_t MAX_MATCH = 18;
+    constexpr uint32_t HASH_BITS = 12;
+
+    inline uint32_t hash3(const unsigned char* data) {
+        return ((uint32_t(data[0]) << 16 | uint32_t(data[1]) << 8 | data[2]) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    inline std::vector<char> compress(const char* data, const uint32_t size) {
+        std::vector<char> out;
+        out.reserve(4 + size + size / 8 + 1);
+        for (uint32_t i = 0; i < 4; i++) out.push_back((char) (size >> (8 * i)));
+
+        const auto input = (const unsigned char*) data;
+        std::vector<int32_t> table(1 << HASH_BITS, -1);
+
+        uint32_t pos = 0;
+        size_t flag_pos = 0;
+        uint32_t bit = 8;
+        while (pos < size) {
+            if (bit == 8) {
+                flag_pos = out.size();
+                out.push_back(0);
+                bit = 0;
+            }
+
+            uint32_t match_length = 0;
+            uint32_t match_distance = 0;
+            if (pos + MIN_MATCH <= size) {
+                const uint32_t hash = hash3(input + pos);
+                const int32_t candidate = table[hash];
+                table[hash] = pos;
+
+                if (candidate >= 0 && pos - candidate <= WINDOW_SIZE) {
+                    const uint32_t max_length = size - pos < MAX_MATCH ? size - pos : MAX_MATCH;
+                    while (match_length < max_length && input[candidate + match_length] == input[pos + match_length]) {
+                        match_length++;
+                    }
+                    match_distance = pos - candidate;
+                }
+            }
+
+            if (match_length >= MIN_MATCH) {
+                const uint32_t distance = match_distance - 1;
+                out[flag_pos] |= (char) (1 << bit);
+                out.push_back((char) (distance & 0xFF));
+                out.push_back((char) ((distance >> 8) << 4 | (match_length - MIN_MATCH)));
+
+                // Positions covered by the match are indexed too so later matches can start from them
+                for (uint32_t i = 1; i < match_length && pos + i + MIN_MATCH <= size; i++) {
+                    table[hash3(input + pos + i)] = pos + i;
+                }
+                pos += match_length;
+            } else {
+                out.push_back((char) input[pos]);
+                pos++;
+            }
+
+            bit++;
+        }
+
+        return out;
+    }
+
+    // Returns `false` when `data` is not a valid compressed payload
+    inline bool decompress(const char* data, const size_t size, std::string& out) {
+        if (size < 4) return false;
+
+        const auto input = (const unsigned char*) data;
+        const uint32_t original_size = uint32_t(input[0]) | uint32_t(input[1]) << 8 | uint32_t(input[2]) << 16 | uint32_t(input[3]) << 24;
+
+        out.clear();
+        out.reserve(original_size);
+
+        size_t pos = 4;
+        while (out.size() < original_size) {
+            if (pos >= size) return false;
+            const unsigned char flags = input[pos++];
+
+            for (uint32_t bit = 0; bit < 8 && out.size() < original_size; bit++) {
+                if ((flags & (1 << bit)) == 0) {
+                    if (pos >= size) return false;
+                    out.push_back((char) input[pos++]);
+                    continue;
+                }
+
+                if (pos + 2 > size) return false;
+                const uint32_t distance = (uint32_t(input[pos]) | uint32_t(input[pos + 1] >> 4) << 8) + 1;
+                const uint32_t length = (input[pos + 1] & 0x0F) + MIN_MATCH;
+                pos += 2;
+
+                if (distance > out.size() || out.size() + length > original_size) return false;
+
+                const size_t from = out.size() - distance;
+                for (uint32_t i = 0; i < length; i++) out.push_back(out[from + i]);
+            }
+        }
+
+        return pos == size;
+    }
+}
@@ -5,14 +5,16 @@
     Variable,\
     MAX_SIZE,\
     #Variable " must be a JSON object (if specified).",\
-    #Variable " should be shorter than " #MAX_SIZE " bytes."\
+    #Variable " should be shorter than " #MAX_SIZE " bytes.",\
+    #Variable " is not well-formed JSON."\
 )
 
 void forum::propose(
     const name proposer,
     const name proposal_name,
     const string& title,
-    const string& proposal_json
+    const string& proposal_json,
+    const time_point_sec& expires_at
 ) {
     require_auth(proposer);
 
@@ -20,16 +22,60 @@ void forum::propose(
     check(title.size() < 1024, "title should be less than 1024 characters long.");
     VALIDATE_JSON(proposal_json, 32768);
 
+    time_point_sec current_time = current_time_point();
+    check(expires_at > current_time, "expires_at must be a value in the future.");
+
+    // Not a perfect assertion since we are not doing real date computation, but good enough for our use case
+    time_point_sec max_expires_at = current_time + SIX_MONTHS_IN_SECONDS;
+    check(expires_at <= max_expires_at, "expires_at must be within 6 months from now.");
+
     proposals proposal_table(_self, _self.value);
     check(proposal_table.find(proposal_name.value) == proposal_table.end(), "proposal with same name already exists.");
 
-    proposal_table.emplace(_self, [&](auto& row) {
+    purges purge_table(_self, _self.value);
+    check(purge_table.find(proposal_name.value) == purge_table.end(), "proposal with same name is still being purged.");
+
+    archives archive_table(_self, _self.value);
+    check(archive_table.find(proposal_name.value) == archive_table.end(), "proposal with same name has been archived.");
+
+    auto proposal_itr = proposal_table.emplace(_self, [&](auto& row) {
         row.proposal_name = proposal_name;
         row.proposer = proposer;
         row.title = title;
+        row.created_at = current_time;
+        row.expires_at = expires_at;
+
+        row.proposal_json_digest = optional<payload_digest>();
+        row.proposal_json_lz = vector<char>();
+
+        const auto& config = get_config();
+        if (config.lean_payloads) {
+            row.proposal_json_digest = optional<payload_digest>(compute_digest(proposal_json));
+            return;
+        }
+
+        if (config.compress_proposals.value_or(false)) {
+            auto compressed = lz::compress(proposal_json.data(), proposal_json.size());
+            if (compressed.size() < proposal_json.size()) {
+                row.proposal_json_digest = optional<payload_digest>(compute_digest(proposal_json));
+                row.proposal_json_lz = std::move(compressed);
+                return;
+            }
+        }
+
         row.proposal_json = proposal_json;
-        row.created_at = current_time_point();
     });
+    track_usage("proposal"_n, 0, eosio::pack_size(*proposal_itr));
+
+    tallies tally_table(_self, _self.value);
+    auto tally_itr = tally_table.emplace(_self, [&](auto& row) {
+        row.proposal_name = proposal_name;
+        row.total = 0;
+        row.updated_at = current_time_point();
+    });
+    track_usage("tally"_n, 0, eosio::pack_size(*tally_itr));
+
+    log_change("propose"_n, proposal_name, proposer);
 }
 
 void forum::vote(
@@ -41,15 +87,52 @@ void forum::vote(
     require_auth(voter);
 
     proposals proposal_table(_self, _self.value);
-    auto& row = proposal_table.get(proposal_name.value, "proposal_name does not exist.");
+    votes vote_table(_self, _self.value);
+    tallies tally_table(_self, _self.value);
 
-    VALIDATE_JSON(vote_json, 8192);
+    cast_vote(proposal_table, vote_table, tally_table, voter, proposal_name, vote, vote_json);
+}
 
+/**
+ * Same as `vote`, with the typed `options` instead of a `vote_json`
+ *
+ * The options are stored as is in the ballot, readers decode them with the ABI.
+ */
+void forum::votetyped(
+    const name voter,
+    const name proposal_name,
+    uint8_t vote,
+    const ballot_options& options
+) {
+    require_auth(voter);
+
+    if (options.delegate != name(0)) {
+        check(options.delegate != voter, "voter cannot delegate to itself.");
+        check(eosio::is_account(options.delegate), "delegate account does not exist.");
+    }
+
+    proposals proposal_table(_self, _self.value);
     votes vote_table(_self, _self.value);
-    update_vote(vote_table, proposal_name, voter, [&](auto& row) {
-        row.vote = vote;
-        row.vote_json = vote_json;
-    });
+    tallies tally_table(_self, _self.value);
+
+    cast_vote(proposal_table, vote_table, tally_table, voter, proposal_name, vote, "", options);
+}
+
+/**
+ * Vote on multiple proposals at once, each entry is handled exactly like a `vote` action
+ */
+void forum::votebatch(const name voter, const vector<vote_entry>& entries) {
+    require_auth(voter);
+
+    check(entries.size() > 0, "entries should contain at least one vote.");
+
+    proposals proposal_table(_self, _self.value);
+    votes vote_table(_self, _self.value);
+    tallies tally_table(_self, _self.value);
+
+    for (const auto& entry : entries) {
+        cast_vote(proposal_table, vote_table, tally_table, voter, entry.proposal_name, entry.vote, entry.vote_json);
+    }
 }
 
 void forum::unvote(const name voter, const name proposal_name) {
@@ -57,16 +140,168 @@ void forum::unvote(const name voter, const name proposal_name) {
 
     proposals proposal_table(_self, _self.value);
     auto& row = proposal_table.get(proposal_name.value, "proposal_name does not exist.");
+    check(!row.is_expired(), "cannot unvote on an expired proposal.");
+
+    uint8_t previous_vote = 0;
+
+    ballots ballot_table(_self, proposal_name.value);
+    auto itr = ballot_table.find(voter.value);
+    if (itr != ballot_table.end()) {
+        previous_vote = itr->vote;
+        release_payload(itr->json_id.value_or(0));
+        track_usage("ballot"_n, eosio::pack_size(*itr), 0);
+        ballot_table.erase(itr);
+    } else {
+        votes vote_table(_self, _self.value);
+        check(
+            erase_legacy_vote(vote_table, proposal_name, voter, previous_vote),
+            "no vote exists for this proposal_name/voter pair."
+        );
+    }
+
+    tallies tally_table(_self, _self.value);
+    update_tally(tally_table, proposal_name, [&](auto& row) {
+        row.remove(previous_vote);
+    });
+
+    log_change("unvote"_n, proposal_name, voter);
+}
+
+/**
+ * Remove the votes of `voter` across all proposals, visiting at most `max_rows` rows
+ *
+ * Legacy votes are found through the `byvoter` index, ballots by probing the scope of each
+ * live proposal. Every legacy vote visited and every proposal probed counts against `max_rows`,
+ * the `unvoteall` cursor of the voter keeps the position and the next call resumes from it.
+ * Votes on expired proposals are frozen until the proposal is finalized, they are left in place.
+ */
+void forum::unvoteall(const name voter, const uint64_t max_rows) {
+    require_auth(voter);
+
+    check(max_rows > 0, "max_rows must be greater than 0.");
+
+    uint64_t budget = max_rows;
+    tallies tally_table(_self, _self.value);
+    proposals proposal_table(_self, _self.value);
+
+    unvoteall_singleton cursor(_self, voter.value);
+    auto state = cursor.get_or_default(unvoteall_row());
+
+    if (!state.legacy_done) {
+        votes vote_table(_self, _self.value);
+        auto index = vote_table.template get_index<"byvoter"_n>();
+
+        auto lower_itr = index.lower_bound(compute_by_voter_key(state.next_legacy, voter));
+        auto upper_itr = index.upper_bound(compute_by_voter_key(name(0xFFFFFFFFFFFFFFFF), voter));
+
+        while (budget > 0 && lower_itr != upper_itr) {
+            budget--;
+
+            auto proposal_itr = proposal_table.find(lower_itr->proposal_name.value);
+            if (proposal_itr != proposal_table.end() && proposal_itr->is_expired()) {
+                lower_itr++;
+                continue;
+            }
+
+            const uint8_t previous_vote = lower_itr->vote;
+            update_tally(tally_table, lower_itr->proposal_name, [&](auto& row) {
+                row.remove(previous_vote);
+            });
+
+            log_change("unvote"_n, lower_itr->proposal_name, voter);
+            track_usage("vote"_n, eosio::pack_size(*lower_itr), 0);
+            lower_itr = index.erase(lower_itr);
+        }
+
+        state.legacy_done = lower_itr == upper_itr;
+        state.next_legacy = state.legacy_done ? name(0) : lower_itr->proposal_name;
+    }
+
+    auto proposal_itr = proposal_table.lower_bound(state.next_proposal.value);
+    if (state.legacy_done) {
+        while (budget > 0 && proposal_itr != proposal_table.end()) {
+            budget--;
+
+            const name proposal_name = proposal_itr->proposal_name;
+            const bool expired = proposal_itr->is_expired();
+            proposal_itr++;
+            if (expired) continue;
+
+            ballots ballot_table(_self, proposal_name.value);
+
+            auto itr = ballot_table.find(voter.value);
+            if (itr == ballot_table.end()) continue;
+
+            const uint8_t previous_vote = itr->vote;
+            update_tally(tally_table, proposal_name, [&](auto& row) {
+                row.remove(previous_vote);
+            });
+
+            log_change("unvote"_n, proposal_name, voter);
+            release_payload(itr->json_id.value_or(0));
+            track_usage("ballot"_n, eosio::pack_size(*itr), 0);
+            ballot_table.erase(itr);
+        }
+    }
+
+    if (state.legacy_done && proposal_itr == proposal_table.end()) {
+        if (cursor.exists()) cursor.remove();
+        return;
+    }
+
+    if (proposal_itr != proposal_table.end()) state.next_proposal = proposal_itr->proposal_name;
+    cursor.set(state, voter);
+}
+
+/**
+ * Update the stake snapshot of the ballot of `voter` on `proposal_name` to its current stake
+ *
+ * Anyone can call this action, ballots of expired proposals are frozen and cannot be refreshed.
+ */
+void forum::refreshballot(const name voter, const name proposal_name) {
+    proposals proposal_table(_self, _self.value);
+    auto& proposal = proposal_table.get(proposal_name.value, "proposal_name does not exist.");
+    check(!proposal.is_expired(), "cannot refresh a ballot of an expired proposal.");
+
+    ballots ballot_table(_self, proposal_name.value);
+    auto& row = ballot_table.get(voter.value, "no ballot exists for this proposal_name/voter pair.");
+
+    const int64_t staked = get_staked(voter);
+    ballot_table.modify(row, eosio::same_payer, [&](auto& row) {
+        const uint64_t before = eosio::pack_size(row);
+        if (!row.vote_json_digest.has_value()) row.vote_json_digest = optional<payload_digest>();
+        row.staked = staked;
+        track_usage("ballot"_n, before, eosio::pack_size(row));
+    });
+}
+
+/**
+ * Move at most `max_rows` votes from the legacy `votes` table to the proposal scoped `ballots` table
+ *
+ * Migrated rows are erased from `votes`, so calling the action again simply resumes the migration.
+ */
+void forum::migrate(const uint64_t max_rows) {
+    check(max_rows > 0, "max_rows must be greater than 0.");
 
     votes vote_table(_self, _self.value);
 
-    auto index = vote_table.template get_index<"byproposal"_n>();
-    auto vote_key = compute_by_proposal_key(proposal_name, voter);
+    uint64_t count = 0;
+    auto itr = vote_table.begin();
+    while (count < max_rows && itr != vote_table.end()) {
+        ballots ballot_table(_self, itr->proposal_name.value);
 
-    auto itr = index.find(vote_key);
-    check(itr != index.end(), "no vote exists for this proposal_name/voter pair.");
+        // A ballot already in the scoped table is always more recent than the legacy row
+        if (ballot_table.find(itr->voter.value) == ballot_table.end()) {
+            auto ballot_itr = ballot_table.emplace(_self, [&](auto& row) {
+                copy_legacy_vote(row, *itr);
+            });
+            track_usage("ballot"_n, 0, eosio::pack_size(*ballot_itr));
+        }
 
-    vote_table.erase(*itr);
+        track_usage("vote"_n, eosio::pack_size(*itr), 0);
+        itr = vote_table.erase(itr);
+        count++;
+    }
 }
 
 void forum::post(
@@ -113,6 +348,7 @@ void forum::status(const name account, const string& content) {
 
     if (content.size() == 0) {
         auto& row = status_table.get(account.value, "no previous status entry for this account.");
+        track_usage("status"_n, eosio::pack_size(row), 0);
         status_table.erase(row);
     } else {
         update_status(status_table, account, [&](auto& row) {
@@ -121,10 +357,131 @@ void forum::status(const name account, const string& content) {
     }
 }
 
+/**
+ * Remove at most `max_rows` statuses not updated for `status_ttl` seconds
+ *
+ * Statuses written before the `byupdated` index are first walked once in `account` order, expired ones
+ * are removed and the others written again to get their index entry. Then expired statuses are taken
+ * from the oldest in `byupdated`. Anyone can call this action.
+ */
+void forum::sweepstatus(const uint64_t max_rows) {
+    check(max_rows > 0, "max_rows must be greater than 0.");
+
+    const uint32_t ttl = get_config().status_ttl.value_or(0);
+    check(ttl > 0, "status_ttl is not enabled.");
+
+    const uint64_t now = current_time_point().sec_since_epoch();
+    uint64_t budget = max_rows;
+
+    statuses status_table(_self, _self.value);
+
+    status_sweep_singleton status_sweep(_self, _self.value);
+    auto state = status_sweep.get_or_default(status_sweep_row());
+    if (!state.reindexed) {
+        auto itr = status_table.lower_bound(state.next_account.value);
+        while (budget > 0 && itr != status_table.end()) {
+            budget--;
+            if (is_status_indexed(status_table, *itr)) {
+                itr++;
+                continue;
+            }
+
+            const status_row row = *itr;
+            track_usage("status"_n, eosio::pack_size(row), 0);
+            itr = status_table.erase(itr);
+
+            // The original payer is not known, the contract takes the RAM over
+            if (row.by_updated() + ttl > now) {
+                auto status_itr = status_table.emplace(_self, [&](auto& new_row) {
+                    new_row = row;
+                });
+                track_usage("status"_n, 0, eosio::pack_size(*status_itr));
+            }
+        }
+
+        state.reindexed = itr == status_table.end();
+        state.next_account = state.reindexed ? name(0) : itr->account;
+        status_sweep.set(state, _self);
+    }
+
+    auto index = status_table.template get_index<"byupdated"_n>();
+    auto itr = index.begin();
+    while (budget > 0 && itr != index.end() && itr->by_updated() + ttl <= now) {
+        track_usage("status"_n, eosio::pack_size(*itr), 0);
+        itr = index.erase(itr);
+        budget--;
+    }
+}
+
+void forum::updateconfig(const config_row& config) {
+    require_auth(_self);
+
+    config_singleton config_table(_self, _self.value);
+    config_table.set(config, _self);
+}
+
+/**
+ * Overwrite the usage of the given tables, to account for the rows written before the gauge existed
+ *
+ * Operators count the rows and bytes off-chain once, the gauge keeps them up to date afterwards.
+ */
+void forum::setgauge(const vector<table_usage>& tables) {
+    require_auth(_self);
+
+    for (const auto& usage : tables) {
+        auto& entry = get_usage(usage.table);
+        entry.rows = usage.rows;
+        entry.bytes = usage.bytes;
+    }
+}
+
+/**
+ * Move the RAM of the status of `account` and of its ballots on `proposal_names` to `account`
+ *
+ * Migration path for rows written before `voter_pays_ram` was enabled, rows are otherwise
+ * billed to their voter/account the next time they are updated.
+ */
+void forum::rebill(const name account, const vector<name>& proposal_names) {
+    require_auth(account);
+
+    check(get_config().voter_pays_ram.value_or(false), "voter_pays_ram is not enabled.");
+
+    statuses status_table(_self, _self.value);
+    auto status_itr = status_table.find(account.value);
+    if (status_itr != status_table.end()) {
+        status_table.modify(status_itr, account, [&](auto& row) {});
+    }
+
+    votes vote_table(_self, _self.value);
+    for (const auto& proposal_name : proposal_names) {
+        ballots ballot_table(_self, proposal_name.value);
+
+        auto itr = ballot_table.find(account.value);
+        if (itr != ballot_table.end()) {
+            ballot_table.modify(itr, account, [&](auto& row) {});
+            continue;
+        }
+
+        // Legacy votes are moved to the proposal scoped storage on the way
+        auto index = vote_table.template get_index<"byproposal"_n>();
+        auto legacy_itr = index.find(compute_by_proposal_key(proposal_name, account));
+        check(legacy_itr != index.end(), "no vote exists for this proposal_name/voter pair.");
+
+        auto ballot_itr = ballot_table.emplace(account, [&](auto& row) {
+            copy_legacy_vote(row, *legacy_itr);
+        });
+        track_usage("ballot"_n, 0, eosio::pack_size(*ballot_itr));
+
+        track_usage("vote"_n, eosio::pack_size(*legacy_itr), 0);
+        index.erase(legacy_itr);
+    }
+}
+
 /**
  * Cancel proposal using the authorization from the {{ proposer }}
  *
- * `proposal` & `votes` will be removed
+ * `proposal` is removed right away, its `votes` are removed by this action up to
+ * `CANCEL_PURGE_ROWS` rows, the remaining ones through the `purge` action.
  */
 void forum::cancel(const name proposer, const name proposal_name) {
     require_auth(proposer);
@@ -136,76 +493,544 @@ void forum::cancel(const name proposer, const name proposal_name) {
 
     // Only original `proposer` of `proposal_name` is authorized to cancel a proposal prior to expiration
     check( proposal_itr->proposer == proposer, "proposer does not match original proposer of proposal_name");
+    check(!proposal_itr->is_expired(), "cannot cancel an expired proposal.");
+
+    track_usage("proposal"_n, eosio::pack_size(*proposal_itr), 0);
+    proposal_table.erase(proposal_itr);
+    start_purge(proposal_name);
+    log_change("cancel"_n, proposal_name, proposer);
+
+    purges purge_table(_self, _self.value);
+    purge_votes(purge_table, proposal_name, CANCEL_PURGE_ROWS);
+}
+
+/**
+ * Remove at most `max_rows` votes of a cancelled proposal
+ *
+ * Progress is recorded in the `purge` row of the proposal, which is removed once all votes are gone.
+ */
+void forum::purge(const name proposal_name, const uint64_t max_rows) {
+    check(max_rows > 0, "max_rows must be greater than 0.");
+
+    purges purge_table(_self, _self.value);
+    check(purge_table.find(proposal_name.value) != purge_table.end(), "no purge in progress for this proposal_name.");
+
+    purge_votes(purge_table, proposal_name, max_rows);
+}
+
+/**
+ * Finalize, archive expired proposals and remove their votes, spending at most `max_rows` ballot visits
+ *
+ * Purges left unfinished (by `cancel` or by a previous `sweep`) are resumed first, then expired proposals
+ * are taken in expiry order. An expired proposal is finalized (see `finalize`) then turned into an `archive`
+ * row holding its final tally and the hash of its `proposal_json`. Anyone can call this action.
+ */
+void forum::sweep(const uint64_t max_rows) {
+    check(max_rows > 0, "max_rows must be greater than 0.");
+
+    uint64_t budget = max_rows;
+
+    purges purge_table(_self, _self.value);
+    auto purge_itr = purge_table.begin();
+    while (budget > 0 && purge_itr != purge_table.end()) {
+        const name proposal_name = purge_itr->proposal_name;
+        budget -= purge_votes(purge_table, proposal_name, budget);
+        purge_itr = purge_table.lower_bound(proposal_name.value + 1);
+    }
+
+    proposals proposal_table(_self, _self.value);
+    auto index = proposal_table.template get_index<"byexpiry"_n>();
+
+    const uint64_t now = current_time_point().sec_since_epoch();
 
+    auto proposal_itr = index.begin();
+    while (budget > 0 && proposal_itr != index.end() && proposal_itr->by_expiry() <= now) {
+        const name proposal_name = proposal_itr->proposal_name;
+
+        // Votes must be counted before they are erased, the next call resumes the count
+        if (!finalize_votes(proposal_name, budget)) break;
+
+        archive_proposal(*proposal_itr);
+        log_change("archive"_n, proposal_name, proposal_itr->proposer);
+        track_usage("proposal"_n, eosio::pack_size(*proposal_itr), 0);
+        proposal_itr = index.erase(proposal_itr);
+
+        start_purge(proposal_name);
+        budget -= purge_votes(purge_table, proposal_name, budget);
+    }
+}
+
+/// Helpers
+
+/**
+ * Count the stake weighted result of an expired proposal, visiting at most `max_rows` ballots
+ *
+ * The partial sums are kept in the `finalizing` row of the proposal, the next call resumes after
+ * the last ballot counted. Once all ballots are counted, the immutable `result` row is written.
+ * Each ballot is weighted by its `staked` snapshot, so the result does not depend on when the calls were made.
+ * Anyone can call this action.
+ */
+void forum::finalize(const name proposal_name, const uint64_t max_rows) {
+    check(max_rows > 0, "max_rows must be greater than 0.");
+
+    proposals proposal_table(_self, _self.value);
+    auto& proposal = proposal_table.get(proposal_name.value, "proposal_name does not exist.");
+    check(proposal.is_expired(), "proposal has not expired yet.");
+
+    results result_table(_self, _self.value);
+    check(result_table.find(proposal_name.value) == result_table.end(), "proposal is already finalized.");
+
+    uint64_t budget = max_rows;
+    finalize_votes(proposal_name, budget);
+}
+
+/**
+ * Return the running tally of `proposal_name`, or its stake weighted result once finalized
+ *
+ * Read-only, the result is the action's return value.
+ */
+forum::tally_view forum::gettally(const name proposal_name) {
+    tally_view view{proposal_name, {}, 0, false, {}, 0};
+
+    results result_table(_self, _self.value);
+    auto result_itr = result_table.find(proposal_name.value);
+    if (result_itr != result_table.end()) {
+        view.votes = result_itr->votes;
+        view.total = result_itr->total;
+        view.finalized = true;
+        view.weights = result_itr->weights;
+        view.total_weight = result_itr->total_weight;
+        return view;
+    }
+
+    tallies tally_table(_self, _self.value);
+    auto& tally = tally_table.get(proposal_name.value, "no tally exists for this proposal_name.");
+    view.votes = tally.votes;
+    view.total = tally.total;
+    return view;
+}
+
+/**
+ * Return at most `limit` ballots of `proposal_name` starting at voter `cursor`, without their `vote_json`
+ *
+ * Read-only, the page is the action's return value. Legacy votes are not part of the pages.
+ */
+forum::ballot_page forum::getballots(const name proposal_name, const name cursor, const uint32_t limit) {
+    if (limit == 0 || limit > MAX_BALLOT_PAGE) {
+        check(false, "limit must be between 1 and " + std::to_string(MAX_BALLOT_PAGE) + ".");
+    }
+
+    ballot_page page;
+    page.ballots.reserve(limit);
+
+    ballots ballot_table(_self, proposal_name.value);
+    auto itr = ballot_table.lower_bound(cursor.value);
+    for (; itr != ballot_table.end() && page.ballots.size() < limit; itr++) {
+        page.ballots.push_back(ballot_view{
+            itr->voter,
+            itr->vote,
+            itr->staked.value_or(0),
+            itr->json_id.value_or(0),
+            itr->updated_at,
+            itr->options.has_value() ? itr->options.value() : optional<ballot_options>()
+        });
+    }
+
+    if (itr != ballot_table.end()) page.next_voter = itr->voter;
+    return page;
+}
+
+const forum::config_row& forum::get_config() {
+    if (!_config.has_value()) {
+        config_singleton config_table(_self, _self.value);
+        _config = config_table.get_or_default(config_row());
+    }
+
+    return _config.value();
+}
+
+void forum::cast_vote(
+    proposals& proposal_table,
+    votes& vote_table,
+    tallies& tally_table,
+    const name voter,
+    const name proposal_name,
+    const uint8_t vote,
+    const string& vote_json,
+    const optional<ballot_options>& options
+) {
+    auto& row = proposal_table.get(proposal_name.value, "proposal_name does not exist.");
+    check(!row.is_expired(), "cannot vote on an expired proposal.");
+
+    VALIDATE_JSON(vote_json, 8192);
+
+    uint8_t previous_vote = 0;
+
+    // A pair has either a ballot or a legacy vote, the legacy table is only searched when no ballot exists.
+    // Votes cast before the proposal scoped storage are moved over on their next update.
+    ballots ballot_table(_self, proposal_name.value);
+    const bool existed = ballot_table.find(voter.value) != ballot_table.end()
+        || erase_legacy_vote(vote_table, proposal_name, voter, previous_vote);
+
+    const bool lean = get_config().lean_payloads;
+
+    // Shared `payloads` rows are paid by the contract, so bodies of voter paid ballots stay inline
+    // and are billed to the voter along with the ballot
+    const bool interned = !lean && ram_payer(voter) == _self;
+
+    // Interned before the previous body is released, re-casting the same body keeps its row
+    const uint64_t json_id = interned ? intern_payload(vote_json) : 0;
+    uint64_t previous_json_id = 0;
+
+    update_ballot(ballot_table, voter, [&](auto& row, const bool is_new) {
+        if (!is_new) {
+            previous_vote = row.vote;
+            previous_json_id = row.json_id.value_or(0);
+        }
+        row.vote = vote;
+        if (lean || interned) {
+            row.vote_json.clear();
+        } else {
+            row.vote_json = vote_json;
+        }
+
+        if (lean) {
+            row.vote_json_digest = optional<payload_digest>(compute_digest(vote_json));
+        } else {
+            row.vote_json_digest = optional<payload_digest>();
+        }
+
+        row.staked = get_staked(voter);
+        row.json_id = json_id;
+        row.options = options;
+    });
+
+    release_payload(previous_json_id);
+
+    update_tally(tally_table, proposal_name, [&](auto& row) {
+        if (existed) row.remove(previous_vote);
+        row.add(vote);
+    });
+
+    log_change("vote"_n, proposal_name, voter, vote);
+}
+
+void forum::archive_proposal(const proposal_row& proposal) {
+    tallies tally_table(_self, _self.value);
+    auto tally_itr = tally_table.find(proposal.proposal_name.value);
+
+    archives archive_table(_self, _self.value);
+    auto archive_itr = archive_table.emplace(_self, [&](auto& row) {
+        row.proposal_name = proposal.proposal_name;
+        row.proposer = proposal.proposer;
+        row.title = proposal.title;
+        row.content_hash = proposal.proposal_json_digest.has_value() && proposal.proposal_json_digest.value().has_value()
+            ? proposal.proposal_json_digest.value()->hash
+            : compute_digest(proposal.proposal_json).hash;
+        row.total = 0;
+        row.created_at = proposal.created_at;
+        row.expires_at = proposal.expires_at.value();
+
+        if (tally_itr != tally_table.end()) {
+            row.votes = tally_itr->votes;
+            row.total = tally_itr->total;
+        }
+    });
+    track_usage("archive"_n, 0, eosio::pack_size(*archive_itr));
+}
+
+bool forum::finalize_votes(const name proposal_name, uint64_t& budget) {
+    results result_table(_self, _self.value);
+    if (result_table.find(proposal_name.value) != result_table.end()) return true;
+    if (budget == 0) return false;
+
+    finalizings finalizing_table(_self, _self.value);
+    auto finalizing_itr = finalizing_table.find(proposal_name.value);
+
+    finalizing_row state{proposal_name, name(0), {}, {}, 0, 0, current_time_point()};
+    if (finalizing_itr != finalizing_table.end()) state = *finalizing_itr;
+
+    ballots ballot_table(_self, proposal_name.value);
+
+    // Legacy votes are moved to the ballot scope before the walk starts, none can be added afterwards
     votes vote_table(_self, _self.value);
     auto index = vote_table.template get_index<"byproposal"_n>();
 
-    auto vote_key_lower_bound = compute_by_proposal_key(proposal_name, name(0x0000000000000000));
-    auto vote_key_upper_bound = compute_by_proposal_key(proposal_name, name(0xFFFFFFFFFFFFFFFF));
+    auto lower_itr = index.lower_bound(compute_by_proposal_key(proposal_name, name(0)));
+    auto upper_itr = index.upper_bound(compute_by_proposal_key(proposal_name, name(0xFFFFFFFFFFFFFFFF)));
+
+    while (budget > 0 && lower_itr != upper_itr) {
+        if (ballot_table.find(lower_itr->voter.value) == ballot_table.end()) {
+            auto ballot_itr = ballot_table.emplace(_self, [&](auto& row) {
+                copy_legacy_vote(row, *lower_itr);
+            });
+            track_usage("ballot"_n, 0, eosio::pack_size(*ballot_itr));
+        }
+
+        track_usage("vote"_n, eosio::pack_size(*lower_itr), 0);
+        lower_itr = index.erase(lower_itr);
+        budget--;
+    }
+
+    auto ballot_itr = ballot_table.lower_bound(state.next_voter.value);
+    if (lower_itr == upper_itr) {
+        while (budget > 0 && ballot_itr != ballot_table.end()) {
+            // Snapshot taken when the ballot was written, live stake would depend on the timing of the calls
+            const int64_t staked = ballot_itr->staked.value_or(0);
+            state.add(ballot_itr->vote, staked > 0 ? (uint64_t) staked : 0);
+
+            ballot_itr++;
+            budget--;
+        }
+    }
+
+    if (lower_itr != upper_itr || ballot_itr != ballot_table.end()) {
+        if (ballot_itr != ballot_table.end()) state.next_voter = ballot_itr->voter;
+        state.updated_at = current_time_point();
+
+        if (finalizing_itr == finalizing_table.end()) {
+            finalizing_table.emplace(_self, [&](auto& row) { row = state; });
+        } else {
+            finalizing_table.modify(finalizing_itr, eosio::same_payer, [&](auto& row) { row = state; });
+        }
 
-    auto lower_itr = index.lower_bound(vote_key_lower_bound);
-    auto upper_itr = index.upper_bound(vote_key_upper_bound);
+        return false;
+    }
+
+    if (finalizing_itr != finalizing_table.end()) finalizing_table.erase(finalizing_itr);
+
+    auto result_itr = result_table.emplace(_self, [&](auto& row) {
+        row.proposal_name = proposal_name;
+        row.votes = state.votes;
+        row.weights = state.weights;
+        row.total = state.total;
+        row.total_weight = state.total_weight;
+        row.finalized_at = current_time_point();
+    });
+    track_usage("result"_n, 0, eosio::pack_size(*result_itr));
 
-    // Iterate over votes and delete rows in `votes` table
-    // To prevent maximum CPU limit errors, only 1500 votes can be removed per `cancel` action
+    log_change("finalize"_n, proposal_name, name(0));
+    return true;
+}
+
+void forum::start_purge(const name proposal_name) {
+    uint64_t remaining = 0;
+
+    // The tally goes away with the proposal, it only tells how many votes are left to erase. Proposals
+    // created before the tally table have none, their `remaining` stays `0` while their votes are erased.
+    tallies tally_table(_self, _self.value);
+    auto tally_itr = tally_table.find(proposal_name.value);
+    if (tally_itr != tally_table.end()) {
+        remaining = tally_itr->total;
+        track_usage("tally"_n, eosio::pack_size(*tally_itr), 0);
+        tally_table.erase(tally_itr);
+    }
+
+    purges purge_table(_self, _self.value);
+    purge_table.emplace(_self, [&](auto& row) {
+        row.proposal_name = proposal_name;
+        row.next_voter = name(0);
+        row.erased = 0;
+        row.remaining = remaining;
+        row.updated_at = current_time_point();
+    });
+}
+
+uint64_t forum::purge_votes(purges& purge_table, const name proposal_name, const uint64_t max_rows) {
+    auto purge_itr = purge_table.find(proposal_name.value);
+    name next_voter = purge_itr->next_voter;
     uint64_t count = 0;
-    while (count < 1500 && lower_itr != upper_itr) {
+
+    // Erased ballots leave the scope, so its first row is always where the previous call stopped
+    ballots ballot_table(_self, proposal_name.value);
+    auto ballot_itr = ballot_table.begin();
+    while (count < max_rows && ballot_itr != ballot_table.end()) {
+        release_payload(ballot_itr->json_id.value_or(0));
+        track_usage("ballot"_n, eosio::pack_size(*ballot_itr), 0);
+        ballot_itr = ballot_table.erase(ballot_itr);
+        count++;
+    }
+
+    // Erased votes leave the index too, so the cursor only narrows the `lower_bound` to where the
+    // previous call stopped, the lookup itself still runs on every call
+    votes vote_table(_self, _self.value);
+    auto index = vote_table.template get_index<"byproposal"_n>();
+
+    auto lower_itr = index.lower_bound(compute_by_proposal_key(proposal_name, next_voter));
+    auto upper_itr = index.upper_bound(compute_by_proposal_key(proposal_name, name(0xFFFFFFFFFFFFFFFF)));
+
+    while (count < max_rows && lower_itr != upper_itr) {
+        next_voter = lower_itr->voter;
+        track_usage("vote"_n, eosio::pack_size(*lower_itr), 0);
         lower_itr = index.erase(lower_itr);
         count++;
     }
 
-    // Let's delete the actual proposal if we deleted all votes and the proposal still exists
-    if (lower_itr == upper_itr && proposal_itr != proposal_table.end()) {
-        proposal_table.erase(proposal_itr);
+    if (ballot_itr == ballot_table.end() && lower_itr == upper_itr) {
+        purge_table.erase(purge_itr);
+        return count;
     }
+
+    purge_table.modify(purge_itr, eosio::same_payer, [&](auto& row) {
+        row.next_voter = next_voter;
+        row.erased += count;
+        row.remaining = row.remaining > count ? row.remaining - count : 0;
+        row.updated_at = current_time_point();
+    });
+
+    return count;
 }
 
-/// Helpers
+int64_t forum::get_staked(const name account) {
+    eosiosystem::voters_table voters("eosio"_n, "eosio"_n.value);
+    auto voter_itr = voters.find(account.value);
+    if (voter_itr != voters.end()) return voter_itr->staked;
 
-void forum::update_status(
-    statuses& status_table,
-    const name account,
-    const function<void(status_row&)> updater
-) {
-    auto itr = status_table.find(account.value);
-    if (itr == status_table.end()) {
-        status_table.emplace(_self, [&](auto& row) {
-            row.account = account;
-            row.updated_at = current_time_point();
-            updater(row);
-        });
-    } else {
-        status_table.modify(itr, eosio::same_payer, [&](auto& row) {
-            row.updated_at = current_time_point();
-            updater(row);
+    eosiosystem::del_bandwidth_table delband("eosio"_n, account.value);
+    auto delband_itr = delband.find(account.value);
+    if (delband_itr != delband.end()) return delband_itr->net_weight.amount + delband_itr->cpu_weight.amount;
+
+    return 0;
+}
+
+uint64_t forum::intern_payload(const string& body) {
+    if (body.empty()) return 0;
+
+    const checksum256 digest = eosio::sha256(body.data(), body.size());
+
+    payloads payload_table(_self, _self.value);
+    auto index = payload_table.template get_index<"bydigest"_n>();
+    auto itr = index.find(digest);
+    if (itr != index.end()) {
+        index.modify(itr, eosio::same_payer, [&](auto& row) {
+            row.refs++;
         });
+        return itr->id;
     }
+
+    // `0` stands for no payload. Shared by every referring ballot, so the contract pays for it
+    const uint64_t id = std::max<uint64_t>(payload_table.available_primary_key(), 1);
+    auto payload_itr = payload_table.emplace(_self, [&](auto& row) {
+        row.id = id;
+        row.digest = digest;
+        row.body = body;
+        row.refs = 1;
+    });
+    track_usage("payload"_n, 0, eosio::pack_size(*payload_itr));
+    return id;
 }
 
-void forum::update_vote(
+void forum::release_payload(const uint64_t json_id) {
+    if (json_id == 0) return;
+
+    payloads payload_table(_self, _self.value);
+    auto itr = payload_table.find(json_id);
+    check(itr != payload_table.end() && itr->refs > 0, "payload references are out of sync with ballots.");
+
+    if (itr->refs == 1) {
+        track_usage("payload"_n, eosio::pack_size(*itr), 0);
+        payload_table.erase(itr);
+        return;
+    }
+
+    payload_table.modify(itr, eosio::same_payer, [&](auto& row) {
+        row.refs--;
+    });
+}
+
+void forum::copy_legacy_vote(ballot_row& row, const vote_row& legacy) {
+    row.voter = legacy.voter;
+    row.vote = legacy.vote;
+    row.vote_json = legacy.vote_json;
+    row.updated_at = legacy.updated_at;
+    row.vote_json_digest = optional<payload_digest>();
+    row.staked = get_staked(legacy.voter);
+
+    // Kept inline, moving a vote over does not intern its body
+    row.json_id = 0;
+}
+
+bool forum::is_status_indexed(statuses& status_table, const status_row& row) {
+    auto index = status_table.template get_index<"byupdated"_n>();
+    for (auto itr = index.lower_bound(row.by_updated()); itr != index.end() && itr->by_updated() == row.by_updated(); itr++) {
+        if (itr->account == row.account) return true;
+    }
+
+    return false;
+}
+
+forum::table_usage& forum::get_usage(const name table) {
+    if (!_gauge.has_value()) {
+        gauge_singleton gauge(_self, _self.value);
+        _gauge = gauge.get_or_default(gauge_row());
+    }
+
+    auto& tables = _gauge->tables;
+    auto itr = std::find_if(tables.begin(), tables.end(), [&](const auto& usage) { return usage.table == table; });
+    if (itr != tables.end()) return *itr;
+
+    tables.push_back(table_usage{table, 0, 0});
+    return tables.back();
+}
+
+void forum::track_usage(const name table, const uint64_t before, const uint64_t after) {
+    auto& usage = get_usage(table);
+
+    // Rows written before the gauge existed are not counted, removing them must not wrap around
+    if (before == 0 && after > 0) usage.rows++;
+    if (before > 0 && after == 0) usage.rows = usage.rows > 0 ? usage.rows - 1 : 0;
+
+    usage.bytes = usage.bytes + after > before ? usage.bytes + after - before : 0;
+}
+
+void forum::log_change(const name action, const name proposal_name, const name account, const uint8_t vote) {
+    // A capacity of 0 disables the change log
+    const uint64_t capacity = get_config().changelog_capacity.value_or(DEFAULT_CHANGELOG_CAPACITY);
+    if (capacity == 0) return;
+
+    if (!_changelog_state.has_value()) {
+        changelog_state_singleton changelog_state(_self, _self.value);
+        _changelog_state = changelog_state.get_or_default(changelog_state_row());
+    }
+
+    const uint64_t seq = _changelog_state->next_seq++;
+
+    changelog changelog_table(_self, _self.value);
+    auto change_itr = changelog_table.emplace(_self, [&](auto& row) {
+        row.seq = seq;
+        row.action = action;
+        row.proposal_name = proposal_name;
+        row.account = account;
+        row.vote = vote;
+        row.created_at = current_time_point();
+    });
+    track_usage("changelog"_n, 0, eosio::pack_size(*change_itr));
+
+    // Evicting up to two entries per append lets the buffer shrink back when the capacity is lowered
+    auto itr = changelog_table.begin();
+    for (uint32_t evicted = 0; evicted < 2 && itr != changelog_table.end() && itr->seq + capacity <= seq; evicted++) {
+        track_usage("changelog"_n, eosio::pack_size(*itr), 0);
+        itr = changelog_table.erase(itr);
+    }
+}
+
+bool forum::erase_legacy_vote(
     votes& vote_table,
     const name proposal_name,
     const name voter,
-    const function<void(vote_row&)> updater
+    uint8_t& previous_vote
 ) {
     auto index = vote_table.template get_index<"byproposal"_n>();
     auto vote_key = compute_by_proposal_key(proposal_name, voter);
 
     auto itr = index.find(vote_key);
-    if (itr == index.end()) {
-        vote_table.emplace(_self, [&](auto& row) {
-            row.id = vote_table.available_primary_key();
-            row.proposal_name = proposal_name;
-            row.voter = voter;
-            row.updated_at = current_time_point();
-            updater(row);
-        });
-    } else {
-        index.modify(itr, eosio::same_payer, [&](auto& row) {
-            row.updated_at = current_time_point();
-            updater(row);
-        });
-    }
+    if (itr == index.end()) return false;
+
+    previous_vote = itr->vote;
+    track_usage("vote"_n, eosio::pack_size(*itr), 0);
+    index.erase(itr);
+
+    return true;
 }
 
 // Do not use directly, use the VALIDATE_JSON macro instead!
@@ -213,11 +1038,14 @@ void forum::validate_json(
     const string& payload,
     size_t max_size,
     const char* not_object_message,
-    const char* over_size_message
+    const char* over_size_message,
+    const char* malformed_message
 ) {
     if (payload.size() <= 0) return;
 
-    check(payload[0] == '{', not_object_message);
+    // Size is checked first so oversized payloads are rejected without being scanned
     check(payload.size() < max_size, over_size_message);
+    check(payload[0] == '{', not_object_message);
+    check(json::validate(payload.data(), payload.size()), malformed_message);
 }
 
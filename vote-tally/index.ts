@@ -4,10 +4,10 @@ import * as write from "write-json-file";
 import * as load from "load-json-file";
 import { CronJob } from "cron";
 import { uploadS3 } from "./src/aws";
-import { Vote, Proposal, Voters, Delband } from "./src/interfaces";
+import { Vote, Proposal, Voters, Delband, Change } from "./src/interfaces";
 import { rpc, CHAIN, CONTRACT_FORUM, DEBUG, CONTRACT_TOKEN, TOKEN_SYMBOL } from "./src/config";
 import { filterVotersByVotes, generateAccounts, generateProxies, generateTallies } from "./src/tallies";
-import { get_table_voters, get_table_vote, get_table_proposal, get_table_delband } from "./src/get_tables";
+import { get_table_voters, get_table_vote, get_table_ballot, get_table_proposal, get_table_delband, get_table_changelog, get_changelog_next_seq, get_changelog_capacity, get_proposal, get_ballot } from "./src/get_tables";
 import { disjoint, parseTokenString, createHash } from "./src/utils";
 import { generateEosioStats } from "./src/stats";
 
@@ -25,6 +25,8 @@ let votes_owner: Set<string> = new Set();
 let voters_owner: Set<string> = new Set();
 let delband: Delband[] = [];
 let currency_supply = null;
+// Sequence of the next `eosio.forum::changelog` entry to apply, `null` until the first full sync
+let next_seq: number | null = null;
 
 /**
  * Sync `eosio` tables
@@ -62,22 +64,95 @@ async function syncEosio(head_block_num: number) {
 
 /**
  * Sync `eosio.forum` tables
+ *
+ * Only the proposals & votes changed since the last sync are fetched, using the `changelog` table.
+ * Falls back to downloading all tables when [full] is set, on the first sync, when the change log is
+ * disabled, or when entries were evicted before being applied.
  */
-async function syncForum(head_block_num: number) {
+async function syncForum(head_block_num: number, full = false) {
     console.log(`syncForum [head_block_num=${head_block_num}]`);
 
-    // fetch `eosio.forum` votes
-    votes = await get_table_vote();
-    votes_owner = new Set(votes.map((row) => row.voter));
+    // Read before the tables, changes logged during a full download are replayed on the next sync
+    const head_seq = await get_changelog_next_seq();
+    const enabled = head_seq !== null && await get_changelog_capacity() > 0;
+
+    let changes: Change[] = [];
+    let applied_seq: number | null = null;
+    if (enabled && head_seq !== null && next_seq !== null && !full) {
+        changes = await get_table_changelog(next_seq);
+        applied_seq = changes.length ? changes[changes.length - 1].seq + 1 : next_seq;
+
+        // Entries missing before the first one fetched or up to `head_seq` were evicted before being applied
+        if ((changes.length && changes[0].seq !== next_seq) || applied_seq < head_seq) applied_seq = null;
+    }
+
+    if (applied_seq === null) {
+        // Stays `null` while the change log is disabled, so every sync downloads all tables
+        next_seq = enabled ? head_seq : null;
 
-    // fetch `eosio.forum` proposal
-    proposals = await get_table_proposal();
+        // fetch `eosio.forum` proposal
+        proposals = await get_table_proposal();
+
+        // fetch `eosio.forum` votes (legacy `vote` table & proposal scoped `ballot` table)
+        votes = (await get_table_vote()).concat(await get_table_ballot(proposals));
+    } else {
+        await applyChanges(changes);
+        next_seq = applied_seq;
+    }
+    votes_owner = new Set(votes.map((row) => row.voter));
 
     // Save JSON
     save(CONTRACT_FORUM, "vote", head_block_num, votes);
     save(CONTRACT_FORUM, "proposal", head_block_num, proposals);
 }
 
+/**
+ * Apply `eosio.forum::changelog` entries to `proposals` & `votes`
+ *
+ * Each changed proposal or vote is fetched once, whatever the number of entries referring to it.
+ */
+async function applyChanges(changes: Change[]) {
+    console.log(`applyChanges [changes=${changes.length}]`);
+
+    const removedProposals = new Set<string>();
+    const changedProposals = new Set<string>();
+    const changedVotes = new Map<string, {proposal_name: string, voter: string}>();
+
+    for (const change of changes) {
+        if (change.action === "propose") {
+            removedProposals.delete(change.proposal_name);
+            changedProposals.add(change.proposal_name);
+        } else if (change.action === "cancel" || change.action === "archive") {
+            changedProposals.delete(change.proposal_name);
+            removedProposals.add(change.proposal_name);
+        } else if (change.action === "finalize") {
+            // Votes are left unchanged, the weighted result lives in the `result` table
+            continue;
+        } else {
+            const key = `${change.proposal_name}:${change.account}`;
+            changedVotes.set(key, {proposal_name: change.proposal_name, voter: change.account});
+        }
+    }
+
+    const voteKey = (row: Vote) => `${row.proposal_name}:${row.voter}`;
+    proposals = proposals.filter((row) => !removedProposals.has(row.proposal_name) && !changedProposals.has(row.proposal_name));
+    // A (re-)proposed proposal starts without votes, its new votes are part of `changedVotes`
+    votes = votes.filter((row) => !removedProposals.has(row.proposal_name) && !changedProposals.has(row.proposal_name) && !changedVotes.has(voteKey(row)));
+
+    for (const proposal_name of Array.from(changedProposals)) {
+        const proposal = await get_proposal(proposal_name);
+        if (proposal) proposals.push(proposal);
+    }
+
+    for (const {proposal_name, voter} of Array.from(changedVotes.values())) {
+        if (removedProposals.has(proposal_name)) continue;
+
+        // `unvote` entries resolve to no ballot
+        const ballot = await get_ballot(proposal_name, voter);
+        if (ballot) votes.push(ballot);
+    }
+}
+
 /**
  * Sync `eosio.token` tables
  */
@@ -147,7 +222,8 @@ async function quickTasks() {
 async function allTasks() {
     const {head_block_num} = await rpc.get_info()
     await syncToken(head_block_num);
-    await syncForum(head_block_num);
+    // Full download, catches anything the change log could not tell (e.g. entries logged while it was disabled)
+    await syncForum(head_block_num, true);
     await syncEosio(head_block_num);
     await calculateTallies(head_block_num);
 }
@@ -1,6 +1,6 @@
-import { delay, parseTokenString } from "./utils";
+import { delay, parseTokenString, decompressProposalJson } from "./utils";
 import { rpc, DELAY_MS, CONTRACT_FORUM } from "./config";
-import { Voters, Vote, Proposal, Delband } from "./interfaces";
+import { Voters, Vote, Ballot, Proposal, Delband, Change, Payload } from "./interfaces";
 
 /**
  * Get Table `eosio::voters`
@@ -28,16 +28,140 @@ export async function get_table_delband(scopes: Set<string>) {
 
 /**
  * Get Table `eosio.forum::vote`
+ *
+ * Legacy votes not yet moved to the proposal scoped `ballot` table
  */
 export function get_table_vote() {
     return get_tables<Vote>(CONTRACT_FORUM, CONTRACT_FORUM, "vote", "id");
 }
 
+/**
+ * Get Table `eosio.forum::ballot`
+ *
+ * Ballots are scoped by `proposal_name`, one scope is fetched per proposal
+ */
+export async function get_table_ballot(proposals: Proposal[]) {
+    const votes: Vote[] = [];
+    const payloads = new Map<number, string>();
+    for (const { proposal_name } of proposals) {
+        const ballots = await get_tables<Ballot>(CONTRACT_FORUM, proposal_name, "ballot", "voter");
+
+        for (const row of ballots) {
+            votes.push({ proposal_name, ...row, vote_json: await resolve_vote_json(row, payloads) });
+        }
+    }
+    return votes;
+}
+
 /**
  * Get Table `eosio.forum::proposal`
  */
-export function get_table_proposal() {
-    return get_tables<Proposal>(CONTRACT_FORUM, CONTRACT_FORUM, "proposal", "proposal_name");
+export async function get_table_proposal() {
+    const proposals = await get_tables<Proposal>(CONTRACT_FORUM, CONTRACT_FORUM, "proposal", "proposal_name");
+
+    // Restore `proposal_json` of proposals stored compressed
+    for (const proposal of proposals) {
+        if (proposal.proposal_json_lz) proposal.proposal_json = decompressProposalJson(proposal.proposal_json_lz);
+    }
+    return proposals;
+}
+
+/**
+ * Get Table `eosio.forum::changelog`
+ *
+ * Entries logged after `lower_bound` (inclusive)
+ */
+export async function get_table_changelog(lower_bound: number) {
+    const changes: Change[] = [];
+    const limit = 1500;
+
+    while (true) {
+        console.log(`get_table_rows [${CONTRACT_FORUM}::${CONTRACT_FORUM}:changelog] size=${changes.length} lower=${lower_bound}`);
+        const response = await rpc.get_table_rows<Change>(CONTRACT_FORUM, CONTRACT_FORUM, "changelog", {
+            json: true,
+            lower_bound: String(lower_bound),
+            limit,
+        });
+        for (const row of response.rows) {
+            changes.push(row);
+            lower_bound = row.seq + 1;
+        }
+        await delay(DELAY_MS);
+
+        if (response.more === false) break;
+    }
+    return changes;
+}
+
+/**
+ * Get Singleton `eosio.forum::changestate`
+ *
+ * Sequence number of the next `changelog` entry, `null` when nothing was ever logged
+ */
+export async function get_changelog_next_seq(): Promise<number | null> {
+    const response = await rpc.get_table_rows<{next_seq: number}>(CONTRACT_FORUM, CONTRACT_FORUM, "changestate", { json: true });
+    return response.rows.length ? Number(response.rows[0].next_seq) : null;
+}
+
+/**
+ * Get `changelog_capacity` of Singleton `eosio.forum::config`
+ *
+ * `0` means the change log is disabled, the contract default applies when the field was never set
+ */
+export async function get_changelog_capacity() {
+    const response = await rpc.get_table_rows<{changelog_capacity?: number}>(CONTRACT_FORUM, CONTRACT_FORUM, "config", { json: true });
+    const capacity = response.rows.length ? response.rows[0].changelog_capacity : undefined;
+    return capacity === undefined || capacity === null ? 10000 : Number(capacity);
+}
+
+/**
+ * Get a single row of `eosio.forum::proposal`
+ */
+export async function get_proposal(proposal_name: string) {
+    const response = await rpc.get_table_rows<Proposal>(CONTRACT_FORUM, CONTRACT_FORUM, "proposal", {
+        json: true,
+        lower_bound: proposal_name,
+        limit: 1,
+    });
+    const proposal = response.rows.find((row) => row.proposal_name === proposal_name);
+    if (proposal && proposal.proposal_json_lz) proposal.proposal_json = decompressProposalJson(proposal.proposal_json_lz);
+    return proposal;
+}
+
+/**
+ * Get a single row of `eosio.forum::ballot`
+ */
+export async function get_ballot(proposal_name: string, voter: string): Promise<Vote | undefined> {
+    const response = await rpc.get_table_rows<Ballot>(CONTRACT_FORUM, proposal_name, "ballot", {
+        json: true,
+        lower_bound: voter,
+        limit: 1,
+    });
+    const ballot = response.rows.find((row) => row.voter === voter);
+    return ballot ? { proposal_name, ...ballot, vote_json: await resolve_vote_json(ballot) } : undefined;
+}
+
+/**
+ * Get the `vote_json` of a ballot, fetching it from `eosio.forum::payload` when interned
+ *
+ * `payloads` caches the bodies already fetched, only share it within a single sync since ids
+ * of removed payloads can be reused
+ */
+export async function resolve_vote_json(ballot: Ballot, payloads = new Map<number, string>()) {
+    if (!ballot.json_id) return ballot.vote_json;
+
+    const cached = payloads.get(ballot.json_id);
+    if (cached !== undefined) return cached;
+
+    const response = await rpc.get_table_rows<Payload>(CONTRACT_FORUM, CONTRACT_FORUM, "payload", {
+        json: true,
+        lower_bound: String(ballot.json_id),
+        limit: 1,
+    });
+    const payload = response.rows.find((row) => Number(row.id) === Number(ballot.json_id));
+    const body = payload ? payload.body : "";
+    if (payload) payloads.set(ballot.json_id, body);
+    return body;
 }
 
 /**
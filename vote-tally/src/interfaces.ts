@@ -12,7 +12,7 @@ export interface Voters {
 }
 
 export interface Vote {
-    id: number;
+    id?: number;
     proposal_name: string;
     voter: string;
     vote: number;
@@ -20,6 +20,47 @@ export interface Vote {
     updated_at: string;
 }
 
+export interface Ballot {
+    voter: string;
+    vote: number;
+    vote_json: string;
+    updated_at: string;
+    /**
+     * Stake of the voter when the ballot was cast or last refreshed
+     */
+    staked?: number;
+    /**
+     * When not `0`, id of the `payload` row holding `vote_json`
+     */
+    json_id?: number;
+    /**
+     * Typed ballot of votes cast through `votetyped`
+     */
+    options?: BallotOptions | null;
+}
+
+export interface BallotOptions {
+    abstain_reason: number;
+    delegate: string;
+    choices: number | string;
+}
+
+export interface Payload {
+    id: number;
+    digest: string;
+    body: string;
+    refs: number;
+}
+
+export interface Change {
+    seq: number;
+    action: "propose" | "cancel" | "finalize" | "archive" | "vote" | "unvote";
+    proposal_name: string;
+    account: string;
+    vote: number;
+    created_at: string;
+}
+
 export interface Proposal {
     proposal_name: string;
     proposer: string;
@@ -27,6 +68,7 @@ export interface Proposal {
     proposal_json: string;
     created_at: string;
     expires_at: string;
+    proposal_json_lz?: string;
 }
 
 export interface Delband {
@@ -57,3 +57,51 @@ export function disjoint(source: Set<string>, target: Set<string>) {
     }
     return result;
 }
+
+/**
+ * Decompress Proposal JSON
+ *
+ * Decodes the `proposal_json_lz` field of `eosio.forum::proposal` rows, compressed with the LZSS codec of
+ * `contracts/eosio.forum/include/lz.hpp` (4 bytes little-endian original size, then groups of one flag byte and
+ * up to 8 literals or 2 bytes matches).
+ *
+ * @param {string} hex Compressed bytes as an hexadecimal string
+ * @returns {string} Original `proposal_json`
+ * @example
+ *
+ * decompressProposalJson("06000000086162630200") //=> "abcabc"
+ */
+export function decompressProposalJson(hex: string) {
+    const input = Buffer.from(hex, "hex");
+    if (input.length < 4) throw new Error("invalid compressed proposal_json");
+
+    const size = input.readUInt32LE(0);
+    const out = Buffer.alloc(size);
+    let length = 0;
+    let pos = 4;
+
+    while (length < size) {
+        if (pos >= input.length) throw new Error("invalid compressed proposal_json");
+        const flags = input[pos++];
+
+        for (let bit = 0; bit < 8 && length < size; bit++) {
+            if ((flags & (1 << bit)) === 0) {
+                if (pos >= input.length) throw new Error("invalid compressed proposal_json");
+                out[length++] = input[pos++];
+                continue;
+            }
+
+            if (pos + 2 > input.length) throw new Error("invalid compressed proposal_json");
+            const distance = (input[pos] | (input[pos + 1] >> 4) << 8) + 1;
+            const matchLength = (input[pos + 1] & 0x0F) + 3;
+            pos += 2;
+
+            if (distance > length || length + matchLength > size) throw new Error("invalid compressed proposal_json");
+            for (let i = 0; i < matchLength; i++) {
+                out[length] = out[length - distance];
+                length++;
+            }
+        }
+    }
+    return out.toString("utf8");
+}